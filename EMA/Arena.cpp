@@ -0,0 +1,92 @@
+#include "Arena.h"
+#include "MemoryManager.h"
+
+// chunk头部：位于chunk起始处（每个chunk一个，对象本身没有头部）
+struct Arena::Chunk {
+    Chunk* next;    // 更早申请的chunk（或保留链表中的下一个）
+    size_t bytes;   // chunk总字节数（含头部，释放时按此大小归还）
+};
+
+namespace {
+// 头部按MALLOC_ALIGNMENT取整，chunk内首个对象与malloc返回的地址对齐一致
+const size_t CHUNK_HEADER_SIZE = (sizeof(void*) + sizeof(size_t) + MALLOC_ALIGNMENT - 1) & ~(MALLOC_ALIGNMENT - 1);
+} // namespace
+
+// -------------------------- Arena 实现 --------------------------
+Arena::Arena(size_t chunk_size, bool reuse_chunks)
+    : chunk_size_(chunk_size < CHUNK_HEADER_SIZE * 2 ? CHUNK_HEADER_SIZE * 2 : chunk_size),
+      reuse_chunks_(reuse_chunks) {}
+
+Arena::~Arena() {
+    release();
+}
+
+void* Arena::allocateSlow(size_t size, size_t alignment) {
+    // 对齐超过chunk自身的对齐时预留填充空间
+    size_t slack = alignment > MALLOC_ALIGNMENT ? alignment - MALLOC_ALIGNMENT : 0;
+    if (size > SIZE_MAX - CHUNK_HEADER_SIZE - slack) return nullptr;
+    size_t needed = CHUNK_HEADER_SIZE + slack + size;
+
+    Chunk* chunk = nullptr;
+    if (needed <= chunk_size_ && spare_) {
+        // 复用保留的标准chunk
+        chunk = spare_;
+        spare_ = chunk->next;
+    } else {
+        size_t bytes = needed <= chunk_size_ ? chunk_size_ : needed;
+        chunk = static_cast<Chunk*>(MemoryManager::allocate(bytes));
+        if (!chunk) return nullptr;
+        chunk->bytes = bytes;
+        reserved_bytes_ += bytes;
+    }
+    chunk->next = head_;
+    head_ = chunk;
+    active_bytes_ += chunk->bytes;
+
+    // 当前chunk剩余部分放弃，从新chunk开始切分
+    ptr_ = reinterpret_cast<char*>(chunk) + CHUNK_HEADER_SIZE;
+    end_ = reinterpret_cast<char*>(chunk) + chunk->bytes;
+    return allocate(size, alignment);
+}
+
+void Arena::rewind(const Marker& marker) {
+    while (head_ && head_ != marker.chunk) popChunk();
+    if (head_) {
+        ptr_ = marker.ptr;
+        end_ = reinterpret_cast<char*>(head_) + head_->bytes;
+    } else {
+        ptr_ = nullptr;
+        end_ = nullptr;
+    }
+}
+
+void Arena::reset() {
+    rewind(Marker());
+}
+
+void Arena::release() {
+    reset();
+    while (spare_) {
+        Chunk* chunk = spare_;
+        spare_ = chunk->next;
+        freeChunk(chunk);
+    }
+}
+
+void Arena::popChunk() {
+    Chunk* chunk = head_;
+    head_ = chunk->next;
+    active_bytes_ -= chunk->bytes;
+    if (reuse_chunks_ && chunk->bytes == chunk_size_) {
+        chunk->next = spare_;
+        spare_ = chunk;
+    } else {
+        freeChunk(chunk);
+    }
+}
+
+void Arena::freeChunk(Chunk* chunk) {
+    // 已知大小：池化chunk不经PageMap查询，直接回到当前线程的本地池
+    reserved_bytes_ -= chunk->bytes;
+    MemoryManager::deallocate(chunk, chunk->bytes);
+}
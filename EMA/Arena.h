@@ -0,0 +1,107 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include "MemoryConfig.h"
+
+// 区域分配器（bump-pointer arena）：生命周期一致的一批对象从同一组chunk顺序切分
+// - 分配只是指针前移，对象没有头部，也不能单独释放
+// - chunk经MemoryManager按固定大小申请（默认落在池化级别，来自线程本地池），
+//   超过chunk大小的请求单独申请一个足够大的chunk
+// - 释放时所有chunk按已知大小一次性归还MemoryManager（池化chunk直接回到当前线程的本地池）
+// - 复用模式（reuse_chunks）：reset/作用域结束时保留标准大小的chunk，供下一轮请求继续使用
+// - 非线程安全：一个Arena只应由一个线程使用
+class Arena {
+private:
+    struct Chunk;
+
+public:
+    // 回退点：ArenaScope记录的位置，回退时之后申请的chunk全部释放（或留待复用）
+    struct Marker {
+        Chunk* chunk = nullptr;
+        char* ptr = nullptr;
+    };
+
+    explicit Arena(size_t chunk_size = ARENA_DEFAULT_CHUNK_SIZE, bool reuse_chunks = false);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // 分配size字节（alignment须为2的幂），内存不足时返回nullptr
+    void* allocate(size_t size, size_t alignment = MALLOC_ALIGNMENT) {
+        uintptr_t p = (reinterpret_cast<uintptr_t>(ptr_) + alignment - 1) & ~(alignment - 1);
+        uintptr_t end = reinterpret_cast<uintptr_t>(end_);
+        if (p < end && size <= end - p) {
+            ptr_ = reinterpret_cast<char*>(p + size);
+            return reinterpret_cast<void*>(p);
+        }
+        return allocateSlow(size, alignment);
+    }
+
+    // 当前位置 / 回退到之前的位置（须按后进先出的顺序回退）
+    Marker mark() const { return Marker{head_, ptr_}; }
+    void rewind(const Marker& marker);
+
+    // 回退到空：复用模式下标准大小的chunk留待复用，否则全部归还
+    void reset();
+
+    // 归还全部chunk（含复用模式保留的chunk）
+    void release();
+
+    // 已切分出的字节数（含chunk头部、对齐填充与chunk尾部浪费）/ 持有的chunk总字节数（含保留待复用的）
+    size_t bytesUsed() const { return active_bytes_ - static_cast<size_t>(end_ - ptr_); }
+    size_t bytesReserved() const { return reserved_bytes_; }
+
+private:
+    // 当前chunk放不下：取保留的chunk或申请新chunk后分配
+    void* allocateSlow(size_t size, size_t alignment);
+
+    // 弹出最新的chunk：复用模式下标准大小的chunk转入保留链表，否则归还MemoryManager
+    void popChunk();
+
+    // 归还一个chunk
+    void freeChunk(Chunk* chunk);
+
+private:
+    size_t chunk_size_;
+    bool reuse_chunks_;
+    Chunk* head_ = nullptr;       // 使用中的chunk（最新的在前）
+    Chunk* spare_ = nullptr;      // 复用模式保留的标准大小chunk
+    char* ptr_ = nullptr;         // 当前chunk的下一个可分配地址
+    char* end_ = nullptr;         // 当前chunk的末尾
+    size_t active_bytes_ = 0;     // 使用中chunk的总字节数
+    size_t reserved_bytes_ = 0;   // 使用中与保留chunk的总字节数
+};
+
+// 作用域区域：构造时记录Arena位置，析构时回退（可嵌套，内层先于外层结束）
+// 也可不传入Arena，此时作用域自带一个Arena，析构时全部归还
+class ArenaScope {
+public:
+    explicit ArenaScope(size_t chunk_size = ARENA_DEFAULT_CHUNK_SIZE)
+        : own_(chunk_size), arena_(own_), marker_(own_.mark()) {}
+    explicit ArenaScope(Arena& arena) : arena_(arena), marker_(arena.mark()) {}
+    // 嵌套：内层作用域与外层共享chunk，结束时只回退内层分配的部分
+    explicit ArenaScope(ArenaScope& parent) : ArenaScope(parent.arena_) {}
+    ~ArenaScope() { arena_.rewind(marker_); }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    void* allocate(size_t size, size_t alignment = MALLOC_ALIGNMENT) {
+        return arena_.allocate(size, alignment);
+    }
+
+    // 提前回退到作用域开始时的位置（请求循环中逐轮复用）
+    void reset() { arena_.rewind(marker_); }
+
+    Arena& arena() { return arena_; }
+
+private:
+    Arena own_;       // 自带的Arena（首次分配前不申请内存，使用外部Arena时没有开销）
+    Arena& arena_;
+    Arena::Marker marker_;
+};
+
+#endif // ARENA_H
@@ -0,0 +1,103 @@
+#include "ChunkProvider.h"
+#include <cstdint>
+#include <new>
+#include <sys/mman.h>
+
+// 按对齐步长向上/向下取整（步长必须是2的幂）
+static size_t alignUpSize(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// 内置实现的实例存放在静态存储中且永不析构（进程退出时页堆仍可能被使用）
+template <typename T>
+static T* neverDestroyed() {
+    alignas(T) static char storage[sizeof(T)];
+    static T* instance = new (storage) T();
+    return instance;
+}
+
+// -------------------------- MmapChunkProvider 实现 --------------------------
+// 匿名mmap，多申请一个CHUNK_SIZE后裁掉首尾，得到按CHUNK_SIZE对齐的区域
+class MmapChunkProvider : public ChunkProvider {
+public:
+    explicit MmapChunkProvider(bool huge_page = false) : huge_page_(huge_page) {}
+
+    void* allocateChunk(size_t size, size_t* actual_size) override {
+        size = alignUpSize(size, CHUNK_SIZE);
+        size_t reserve = size + CHUNK_SIZE;
+        void* mem = mmap(nullptr, reserve, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) return nullptr;
+
+        uintptr_t begin = reinterpret_cast<uintptr_t>(mem);
+        uintptr_t aligned = alignUpSize(begin, CHUNK_SIZE);
+        if (aligned > begin) munmap(mem, aligned - begin);
+        uintptr_t end = begin + reserve;
+        if (end > aligned + size) munmap(reinterpret_cast<void*>(aligned + size), end - aligned - size);
+
+        void* chunk = reinterpret_cast<void*>(aligned);
+#ifdef MADV_HUGEPAGE
+        if (huge_page_) madvise(chunk, size, MADV_HUGEPAGE);
+#endif
+        *actual_size = size;
+        return chunk;
+    }
+
+    void releasePages(void* ptr, size_t size) override {
+        madvise(ptr, size, MADV_DONTNEED);
+    }
+
+private:
+    bool huge_page_;
+};
+
+// -------------------------- HugeTlbChunkProvider 实现 --------------------------
+class HugeTlbChunkProvider : public ChunkProvider {
+public:
+    void* allocateChunk(size_t size, size_t* actual_size) override {
+#ifdef MAP_HUGETLB
+        size_t aligned_size = alignUpSize(size, CHUNK_SIZE);
+        void* mem = mmap(nullptr, aligned_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (mem != MAP_FAILED) {
+            has_huge_tlb_ = true;
+            *actual_size = aligned_size;
+            return mem;
+        }
+#endif
+        // 未预留大页（或平台不支持）：退回透明大页
+        return fallback_.allocateChunk(size, actual_size);
+    }
+
+    void releasePages(void* ptr, size_t size) override {
+        // 从未成功申请过显式大页：全部为透明大页chunk，可按普通页归还
+        if (!has_huge_tlb_) return fallback_.releasePages(ptr, size);
+
+        // 大页无法部分归还：只对完全覆盖的大页调用madvise（对普通页同样有效）
+        uintptr_t begin = alignUpSize(reinterpret_cast<uintptr_t>(ptr), CHUNK_SIZE);
+        uintptr_t end = (reinterpret_cast<uintptr_t>(ptr) + size) & ~(CHUNK_SIZE - 1);
+        if (begin < end) madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+    }
+
+private:
+    MmapChunkProvider fallback_{true};
+    bool has_huge_tlb_ = false; // 页堆持锁调用，无需原子
+};
+
+// -------------------------- ChunkProvider 工厂 --------------------------
+ChunkProvider* ChunkProvider::createDefault() {
+    struct DefaultProvider : MmapChunkProvider {
+        DefaultProvider() : MmapChunkProvider(false) {}
+    };
+    return neverDestroyed<DefaultProvider>();
+}
+
+ChunkProvider* ChunkProvider::createHugePage() {
+    struct HugePageProvider : MmapChunkProvider {
+        HugePageProvider() : MmapChunkProvider(true) {}
+    };
+    return neverDestroyed<HugePageProvider>();
+}
+
+ChunkProvider* ChunkProvider::createHugeTlb() {
+    return neverDestroyed<HugeTlbChunkProvider>();
+}
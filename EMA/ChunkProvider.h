@@ -0,0 +1,36 @@
+#ifndef CHUNK_PROVIDER_H
+#define CHUNK_PROVIDER_H
+
+#include <cstddef>
+#include "MemoryConfig.h"
+
+// 大块内存提供者：页堆从中申请大块区域（chunk）并切分为Span（参考MNN BufferAllocator::Allocator）
+// - allocateChunk返回按CHUNK_SIZE对齐、大小为CHUNK_SIZE整数倍的区域
+// - releasePages归还区域中一段空闲页的物理内存（保留地址空间）
+// - 页堆从不释放已申请的chunk；实例须在进程生命周期内有效
+class ChunkProvider {
+public:
+    ChunkProvider() = default;
+    virtual ~ChunkProvider() = default;
+
+    ChunkProvider(const ChunkProvider&) = delete;
+    ChunkProvider& operator=(const ChunkProvider&) = delete;
+
+    // 申请至少size字节的区域（向上取整到CHUNK_SIZE），实际大小写入actual_size，失败返回nullptr
+    virtual void* allocateChunk(size_t size, size_t* actual_size) = 0;
+
+    // 归还[ptr, ptr + size)的物理内存（ptr与size按页对齐）
+    virtual void releasePages(void* ptr, size_t size) = 0;
+
+    // 默认：匿名mmap，按CHUNK_SIZE对齐（系统THP为always模式时可直接使用大页）
+    static ChunkProvider* createDefault();
+
+    // 透明大页：在默认基础上对每个chunk调用madvise(MADV_HUGEPAGE)
+    static ChunkProvider* createHugePage();
+
+    // 显式大页：mmap(MAP_HUGETLB)使用预留的hugetlbfs大页，系统未预留时退回透明大页
+    // 注意：大页只能整页归还，releasePages仅归还完全覆盖的2MB大页
+    static ChunkProvider* createHugeTlb();
+};
+
+#endif // CHUNK_PROVIDER_H
@@ -0,0 +1,226 @@
+#include "HeapProfiler.h"
+#include "MetadataAllocator.h"
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <mutex>
+#include <unistd.h>
+
+// 记录调用栈时跳过的栈帧：HeapProfiler::recordAllocation与MemoryManager::allocateSampled
+const int SKIPPED_FRAMES = 2;
+
+thread_local intptr_t HeapProfiler::bytes_until_sample_ = 0;
+thread_local uint64_t HeapProfiler::random_state_ = 0;
+thread_local bool HeapProfiler::in_profiler_ = false;
+std::atomic_size_t HeapProfiler::interval_{0};
+std::atomic_bool HeapProfiler::ever_enabled_{false};
+
+// -------------------------- 存活抽样表 --------------------------
+// 抽样记录的元数据分配器（不经过malloc，避免在分配路径内递归）
+static MetadataAllocator<HeapSample>& sampleAllocator() {
+    static MetadataAllocator<HeapSample> allocator;
+    return allocator;
+}
+
+// 存活抽样链表（抽中的分配很少，一把锁即可）
+static std::mutex samples_mutex;
+static HeapSample* samples_head = nullptr;
+static size_t samples_count = 0;
+static size_t samples_bytes = 0;
+
+// 输出缓冲：格式化到栈上缓冲区后经write写出（不分配内存，持锁期间不会进入分配器）
+class ProfileWriter {
+public:
+    explicit ProfileWriter(int fd) : fd_(fd) {}
+    ~ProfileWriter() { flush(); }
+
+    void append(const char* data, size_t len) {
+        while (len > 0 && ok_) {
+            size_t n = len < sizeof(buffer_) - used_ ? len : sizeof(buffer_) - used_;
+            memcpy(buffer_ + used_, data, n);
+            used_ += n;
+            data += n;
+            len -= n;
+            if (used_ == sizeof(buffer_)) flush();
+        }
+    }
+
+    template <typename... Args>
+    void print(const char* format, Args... args) {
+        char line[128];
+        int n = snprintf(line, sizeof(line), format, args...);
+        if (n > 0) append(line, static_cast<size_t>(n) < sizeof(line) ? static_cast<size_t>(n) : sizeof(line) - 1);
+    }
+
+    bool flush() {
+        size_t done = 0;
+        while (ok_ && done < used_) {
+            ssize_t n = write(fd_, buffer_ + done, used_ - done);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                ok_ = false;
+                break;
+            }
+            done += static_cast<size_t>(n);
+        }
+        used_ = 0;
+        return ok_;
+    }
+
+private:
+    int fd_;
+    bool ok_ = true;
+    size_t used_ = 0;
+    char buffer_[4096];
+};
+
+// -------------------------- HeapProfiler 实现 --------------------------
+bool HeapProfiler::start(size_t mean_interval) {
+    if (mean_interval == 0) mean_interval = HEAP_SAMPLE_INTERVAL;
+
+    // 预热backtrace：glibc首次调用时加载libgcc_s（期间会调用malloc），不能发生在分配路径上
+    void* frame[1];
+    in_profiler_ = true;
+    backtrace(frame, 1);
+    in_profiler_ = false;
+
+    // 先标记开启过，再发布间隔：抽中的Span出现之前，按大小释放已能看到标记
+    ever_enabled_.store(true, std::memory_order_relaxed);
+    interval_.store(mean_interval, std::memory_order_release);
+    bytes_until_sample_ = nextInterval(mean_interval);
+    return true;
+}
+
+void HeapProfiler::stop() {
+    interval_.store(0, std::memory_order_relaxed);
+}
+
+bool HeapProfiler::takeSample() {
+    size_t mean = interval_.load(std::memory_order_acquire);
+    if (mean == 0) {
+        // 未开启：隔一段分配量再检查开关
+        bytes_until_sample_ = static_cast<intptr_t>(HEAP_SAMPLE_RECHECK_BYTES);
+        return false;
+    }
+    bytes_until_sample_ = nextInterval(mean);
+    return !in_profiler_;
+}
+
+intptr_t HeapProfiler::nextInterval(size_t mean) {
+    if (random_state_ == 0) {
+        uint64_t seed = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+        random_state_ = (seed ^ reinterpret_cast<uintptr_t>(&random_state_)) | 1;
+    }
+    // xorshift64*，取高53位得到(0, 1]上的均匀数，再变换为指数分布
+    uint64_t x = random_state_;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    random_state_ = x;
+    double u = static_cast<double>(((x * 2685821657736338717ULL) >> 11) + 1) * (1.0 / 9007199254740992.0);
+    double next = -std::log(u) * static_cast<double>(mean);
+    const double max_next = static_cast<double>(INTPTR_MAX / 2);
+    return next < 1 ? 1 : (next > max_next ? static_cast<intptr_t>(max_next) : static_cast<intptr_t>(next));
+}
+
+void HeapProfiler::recordAllocation(Span* span, size_t size) {
+    in_profiler_ = true;
+    HeapSample* sample = sampleAllocator().allocate();
+    if (sample) {
+        void* frames[HEAP_PROFILE_MAX_DEPTH + SKIPPED_FRAMES];
+        int depth = backtrace(frames, static_cast<int>(HEAP_PROFILE_MAX_DEPTH + SKIPPED_FRAMES));
+        int skip = depth > SKIPPED_FRAMES ? SKIPPED_FRAMES : 0;
+        sample->size = size;
+        sample->depth = static_cast<size_t>(depth - skip);
+        memcpy(sample->stack, frames + skip, sample->depth * sizeof(void*));
+    }
+    in_profiler_ = false;
+    if (!sample) return;
+
+    span->sample = sample;
+    std::lock_guard<std::mutex> lock(samples_mutex);
+    sample->prev = nullptr;
+    sample->next = samples_head;
+    if (samples_head) samples_head->prev = sample;
+    samples_head = sample;
+    ++samples_count;
+    samples_bytes += size;
+}
+
+void HeapProfiler::recordFree(Span* span) {
+    HeapSample* sample = span->sample;
+    if (!sample) return;
+    span->sample = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(samples_mutex);
+        if (sample->prev) {
+            sample->prev->next = sample->next;
+        } else {
+            samples_head = sample->next;
+        }
+        if (sample->next) sample->next->prev = sample->prev;
+        --samples_count;
+        samples_bytes -= sample->size;
+    }
+    sampleAllocator().deallocate(sample);
+}
+
+size_t HeapProfiler::sampledCount() {
+    std::lock_guard<std::mutex> lock(samples_mutex);
+    return samples_count;
+}
+
+size_t HeapProfiler::sampledBytes() {
+    std::lock_guard<std::mutex> lock(samples_mutex);
+    return samples_bytes;
+}
+
+bool HeapProfiler::writeProfile(int fd) {
+    if (fd < 0) return false;
+    bool saved = in_profiler_;
+    in_profiler_ = true;
+    ProfileWriter out(fd);
+    {
+        // heap_v2：每行为一个抽样的原始次数与字节数（存活与累计相同），pprof按抽样间隔还原
+        std::lock_guard<std::mutex> lock(samples_mutex);
+        size_t interval = interval_.load(std::memory_order_relaxed);
+        if (interval == 0) interval = HEAP_SAMPLE_INTERVAL;
+        out.print("heap profile: %6zu: %8zu [%6zu: %8zu] @ heap_v2/%zu\n", samples_count, samples_bytes,
+                  samples_count, samples_bytes, interval);
+        for (HeapSample* sample = samples_head; sample; sample = sample->next) {
+            out.print("%6d: %8zu [%6d: %8zu] @", 1, sample->size, 1, sample->size);
+            for (size_t i = 0; i < sample->depth; ++i) {
+                out.print(" %p", sample->stack[i]);
+            }
+            out.append("\n", 1);
+        }
+    }
+
+    // 附上内存映射，pprof据此将地址对应到可执行文件与动态库
+    const char maps_header[] = "\nMAPPED_LIBRARIES:\n";
+    out.append(maps_header, sizeof(maps_header) - 1);
+    int maps = open("/proc/self/maps", O_RDONLY | O_CLOEXEC);
+    if (maps >= 0) {
+        char buffer[4096];
+        ssize_t n;
+        while ((n = read(maps, buffer, sizeof(buffer))) > 0 || (n < 0 && errno == EINTR)) {
+            if (n > 0) out.append(buffer, static_cast<size_t>(n));
+        }
+        close(maps);
+    }
+    bool ok = out.flush();
+    in_profiler_ = saved;
+    return ok;
+}
+
+bool HeapProfiler::dumpProfile(const char* path) {
+    if (!path) return false;
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    bool ok = writeProfile(fd);
+    return close(fd) == 0 && ok;
+}
@@ -0,0 +1,78 @@
+#ifndef HEAP_PROFILER_H
+#define HEAP_PROFILER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "MemoryConfig.h"
+#include "Span.h"
+
+// 一次被抽中的分配：申请大小与分配时的调用栈
+struct HeapSample {
+    size_t size = 0;
+    size_t depth = 0;
+    void* stack[HEAP_PROFILE_MAX_DEPTH];
+    HeapSample* next = nullptr;     // 存活抽样的双向链表
+    HeapSample* prev = nullptr;
+};
+
+// 抽样堆分析（参考tcmalloc/gperftools的heap sampling）：
+// - 每个线程维护一个字节倒计数，分配时扣减，减到负数才进入慢路径；
+//   未抽中的分配只付出一次线程本地减法
+// - 抽样间隔服从以平均间隔为均值的指数分布，抽中概率与分配大小成正比，避免与分配模式同步
+// - 抽中的分配独占一个页Span，Span记录抽样信息；释放时经PageMap查到的Span即可判断，
+//   未抽中的释放路径没有额外开销（按大小释放在开启过分析后改走PageMap查询）
+// - 按需输出gperftools/pprof兼容的heap_v2文本格式，由pprof按抽样间隔还原实际用量
+class HeapProfiler {
+public:
+    // 开启抽样（mean_interval为平均抽样间隔字节数，0表示HEAP_SAMPLE_INTERVAL）
+    // 其他线程在下一次倒计数到期时生效（最多HEAP_SAMPLE_RECHECK_BYTES）
+    static bool start(size_t mean_interval = 0);
+
+    // 停止抽样（已记录的存活抽样保留到对应内存释放）
+    static void stop();
+
+    static bool enabled() { return interval_.load(std::memory_order_relaxed) != 0; }
+
+    // 是否开启过抽样（此后可能存在带抽样记录的Span，按大小释放须经PageMap查询）
+    static bool everEnabled() { return ever_enabled_.load(std::memory_order_relaxed); }
+
+    // 扣减当前线程的倒计数，减到负数时返回true（由调用方进入takeSample）
+    static bool countdown(size_t size) {
+        bytes_until_sample_ -= static_cast<intptr_t>(size);
+        return __builtin_expect(bytes_until_sample_ < 0, 0);
+    }
+
+    // 倒计数到期：重新抽取下一个间隔，返回本次分配是否应被抽样
+    static bool takeSample();
+
+    // 为抽中的分配（已独占span）记录调用栈；记录失败时span按普通大块内存使用
+    static void recordAllocation(Span* span, size_t size);
+
+    // 抽中的分配被释放（span随后交还页堆）
+    static void recordFree(Span* span);
+
+    // 当前存活抽样的个数与申请字节数（未按抽样间隔还原）
+    static size_t sampledCount();
+    static size_t sampledBytes();
+
+    // 将存活抽样以pprof heap_v2格式写入fd（附/proc/self/maps供符号化）
+    static bool writeProfile(int fd);
+
+    // 写入到path（覆盖已有文件）
+    static bool dumpProfile(const char* path);
+
+private:
+    // 以当前平均间隔抽取下一个倒计数
+    static intptr_t nextInterval(size_t mean);
+
+private:
+    // 当前线程距下一次抽样的字节数（initial-exec：作为malloc替代时访问不经过__tls_get_addr）
+    static thread_local intptr_t bytes_until_sample_ __attribute__((tls_model("initial-exec")));
+    static thread_local uint64_t random_state_ __attribute__((tls_model("initial-exec")));
+    static thread_local bool in_profiler_ __attribute__((tls_model("initial-exec"))); // 防止分析自身的分配被抽样
+    static std::atomic_size_t interval_;        // 平均抽样间隔，0表示未开启
+    static std::atomic_bool ever_enabled_;
+};
+
+#endif // HEAP_PROFILER_H
@@ -0,0 +1,40 @@
+#ifndef MEMORY_CONFIG_H
+#define MEMORY_CONFIG_H
+
+#include <cstddef>
+
+// 统计开关：为0时线程本地池的计数器全部编译为空操作（CMake选项EMA_ENABLE_STATS）
+#ifndef EMA_ENABLE_STATS
+#define EMA_ENABLE_STATS 1
+#endif
+
+// 核心配置（可根据需求调整）
+const size_t MIN_USER_SIZE = 8;         // 用户可请求的最小大小（字节）
+const size_t MAX_USER_SIZE = 256 * 1024; // 用户可请求的最大池化大小（超过则直接从页堆分配整段页）
+const size_t MAX_SMALL_SIZE = 2048;     // 小对象上限：不超过该大小的级别使用尽量少的页组成Span
+const size_t MEDIUM_SPAN_MIN_BYTES = 64 * 1024; // 中等对象（MAX_SMALL_SIZE以上）每个Span的最小字节数
+const size_t BLOCK_ALIGNMENT = 8;       // 内存对齐步长（必须是2的幂）
+const size_t MALLOC_ALIGNMENT = 16;     // 不小于该大小的块按该值对齐（满足alignof(max_align_t)，可替代malloc）
+const size_t PAGE_SIZE = 4096;          // 批量分配的页大小（系统页大小通常为4096）
+const size_t PAGE_SHIFT = 12;           // 页大小的log2（页号 = 地址 >> PAGE_SHIFT）
+const size_t MAX_GLOBAL_FREE_MEMORY = 10 * 1024 * 1024; // 页堆保留的最大空闲内存（10MB，默认值，可运行时调整）
+const long DEFAULT_DECAY_MS = 10000;    // 空闲页驻留超过该时长后由后台线程归还系统（默认10秒）
+const long MIN_PURGE_INTERVAL_MS = 10;  // 后台归还线程的最短/最长唤醒间隔
+const long MAX_PURGE_INTERVAL_MS = 1000;
+const size_t CHUNK_SIZE = 2 * 1024 * 1024; // 页堆向系统申请内存的粒度与对齐（2MB，与x86_64大页一致）
+const size_t MAX_SMALL_SPAN_PAGES = 128; // 页堆按页数精确分链表的上限，更大的Span进入大块链表
+const size_t THREAD_CACHE_CLASS_MAX_BYTES = 256 * 1024; // 线程本地池单个级别链表的内存上限
+const size_t MAX_THREAD_LIST_LENGTH = 8192;             // 线程本地池单个级别链表的块数上限
+const size_t MAX_LIST_OVERAGES = 3;     // 链表连续超限多少次后收缩上限
+const size_t PER_CPU_CLASS_MAX_BYTES = 64 * 1024;       // 每CPU缓存模式下单个CPU单个级别的内存上限
+const size_t MAX_NUMA_NODES = 8;        // 支持的NUMA节点数上限（每个节点独立的中心缓存与页堆）
+const size_t ARENA_DEFAULT_CHUNK_SIZE = 64 * 1024; // 区域分配器每个chunk的默认大小（落在池化级别内）
+const size_t HEAP_SAMPLE_INTERVAL = 512 * 1024;     // 堆分析默认的平均抽样间隔（每分配约512KB抽样一次）
+const size_t HEAP_SAMPLE_RECHECK_BYTES = 16 * 1024 * 1024; // 未开启堆分析时线程每分配这么多字节检查一次开关
+const size_t HEAP_PROFILE_MAX_DEPTH = 32;  // 抽样记录的调用栈最大深度
+
+static_assert((static_cast<size_t>(1) << PAGE_SHIFT) == PAGE_SIZE, "PAGE_SHIFT must match PAGE_SIZE");
+static_assert((CHUNK_SIZE & (CHUNK_SIZE - 1)) == 0 && CHUNK_SIZE % PAGE_SIZE == 0,
+              "CHUNK_SIZE must be a power of 2 and a multiple of PAGE_SIZE");
+
+#endif // MEMORY_CONFIG_H
@@ -1,6 +1,16 @@
 #include "MemoryManager.h"
+#include "MetadataAllocator.h"
+#include "Numa.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <iomanip>
+#include <sstream>
+#include <vector>
+#ifndef EMA_INTERPOSE
+#include <malloc.h>
+#endif
 
 // -------------------------- 工具函数 --------------------------
 void mutex_print(const std::string& msg) {
@@ -10,327 +20,1082 @@ void mutex_print(const std::string& msg) {
 }
 
 
+#ifndef EMA_INTERPOSE
 // 按对齐步长向上取整（步长必须是2的幂）
 static size_t alignUp(size_t value, size_t alignment) {
     assert((alignment & (alignment - 1)) == 0 && "Alignment must be power of 2");
     return (value + alignment - 1) & ~(alignment - 1);
 }
+#endif
 
 // 【关键修复】定义线程本地静态成员（每个线程独立实例，同一线程内共享）
-thread_local ThreadLocalMemoryPool MemoryManager::local_pool_;
+thread_local ThreadLocalMemoryPool* MemoryManager::local_pool_ = nullptr;
 
-// -------------------------- BaseMemoryPool 实现 --------------------------
-BaseMemoryPool::BaseMemoryPool() {
-    // 初始化预设块大小（用户可用大小8~2048，对应块总大小=用户大小+头部）
-    for (size_t user_size = MIN_USER_SIZE; user_size <= MAX_USER_SIZE; user_size += BLOCK_ALIGNMENT) {
-        size_t total_size = calcAlignedTotalSize(user_size);
-        addBlockSizeIfNotExist(total_size);
-    }
-}
+// 远程释放队列关闭标记（所属线程已退出）
+static FreeBlock* const REMOTE_FREE_CLOSED = reinterpret_cast<FreeBlock*>(1);
 
-size_t BaseMemoryPool::calcAlignedTotalSize(size_t user_size) const {
-    if (user_size == 0) user_size = MIN_USER_SIZE;
-    size_t total_size = user_size + FREE_BLOCK_HEADER_SIZE;
-    return alignUp(total_size, BLOCK_ALIGNMENT);
-}
+// -------------------------- BaseMemoryPool 实现 --------------------------
+// 尺寸级别表的定义（C++14要求在某个翻译单元中定义constexpr静态成员）
+constexpr SizeClassTable SizeClass::TABLE;
 
-int BaseMemoryPool::findBlockSizeIndex(size_t total_size) const {
-    auto it = std::lower_bound(block_sizes_.begin(), block_sizes_.end(), total_size);
-    if (it != block_sizes_.end() && *it == total_size) {
-        return static_cast<int>(std::distance(block_sizes_.begin(), it));
-    }
-    return -1;
+BaseMemoryPool::BaseMemoryPool() : free_lists_() {
+    // 尺寸级别在编译期确定，无需运行时构建块大小列表
 }
 
-int BaseMemoryPool::addBlockSizeIfNotExist(size_t total_size) {
-    // 检查是否已存在
-    int index = findBlockSizeIndex(total_size);
-    if (index != -1) return index;
+void* BaseMemoryPool::allocate(size_t user_size) {
+    // 超大内存直接返回nullptr（交给malloc）
+    if (user_size > MAX_USER_SIZE) return nullptr;
 
-    // 插入到有序列表
-    auto it = std::lower_bound(block_sizes_.begin(), block_sizes_.end(), total_size);
-    index = static_cast<int>(std::distance(block_sizes_.begin(), it));
-    block_sizes_.insert(it, total_size);
-    free_lists_.insert(free_lists_.begin() + index, nullptr);
-    free_block_counts_.insert(free_block_counts_.begin() + index, 0);
-    return index;
-}
+    // 查表得到尺寸级别（O(1)）
+    if (user_size == 0) user_size = MIN_USER_SIZE;
+    size_t index = SizeClass::sizeToClass(user_size);
 
-bool BaseMemoryPool::allocateBatch(size_t total_size, int index) {
-    if (index < 0 || index >= static_cast<int>(block_sizes_.size())) return false;
-    if (total_size == 0 || PAGE_SIZE < total_size) return false;
+    // 从链表头取出一块（链表为空由上层从中心缓存补充）
+    FreeBlock* block = free_lists_[index];
+    if (!block) return nullptr;
+    free_lists_[index] = block->next;
 
-    // 计算一页能拆分的块数
-    size_t block_count = PAGE_SIZE / total_size;
-    if (block_count == 0) return false;
+    // 更新统计信息
+    free_block_counts_[index].sub(1);
+    total_free_memory_.sub(SizeClass::classToSize(index));
+    allocate_counts_[index].add(1);
 
-    // 批量分配一页内存
-    void* page = malloc(PAGE_SIZE);
-    if (!page) return false;
+    // 用户数据区即块起始地址（无头部）
+    return block;
+}
 
-    // 拆分页为多个块，串联成空闲链表
-    FreeBlock* prev = nullptr;
-    for (size_t i = 0; i < block_count; ++i) {
-        char* block_addr = static_cast<char*>(page) + i * total_size;
-        FreeBlock* block = reinterpret_cast<FreeBlock*>(block_addr);
-        block->size = total_size; // 设置块总大小
-        block->next = nullptr;
+void BaseMemoryPool::deallocate(void* user_ptr, size_t cls) {
+    if (!user_ptr || cls == 0 || cls >= NUM_SIZE_CLASSES) return;
 
-        if (prev) prev->next = block;
-        else free_lists_[index] = block; // 第一个块作为链表头
-        prev = block;
-    }
+    // 将块插入链表头（高效）
+    FreeBlock* block = static_cast<FreeBlock*>(user_ptr);
+    block->next = free_lists_[cls];
+    free_lists_[cls] = block;
 
     // 更新统计信息
-    free_block_counts_[index] += block_count;
-    total_free_memory_ += total_size * block_count;
-    total_allocated_memory_ += PAGE_SIZE;
-
-    return true;
+    free_block_counts_[cls].add(1);
+    total_free_memory_.add(SizeClass::classToSize(cls));
+    deallocate_counts_[cls].add(1);
 }
 
-size_t BaseMemoryPool::reclaimIdleMemory() {
-    size_t reclaimed_size = 0;
+size_t BaseMemoryPool::allocateRange(size_t cls, size_t count, void** out) {
+    if (count > freeCount(cls)) count = freeCount(cls);
+    if (count == 0) return 0;
 
-    // 遍历所有块大小链表，回收超出保留数量的空闲块
-    for (int i = 0; i < static_cast<int>(block_sizes_.size()); ++i) {
-        size_t total_size = block_sizes_[i];
-        size_t current_count = free_block_counts_[i];
-        if (current_count <= RESERVE_BLOCK_COUNT) continue;
+    FreeBlock* block = free_lists_[cls];
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = block;
+        block = block->next;
+    }
+    free_lists_[cls] = block;
 
-        // 计算可释放的块数（按页对齐，保证释放整页内存）
-        size_t release_count = current_count - RESERVE_BLOCK_COUNT;
-        size_t blocks_per_page = PAGE_SIZE / total_size;
-        if (blocks_per_page == 0) continue;
+    free_block_counts_[cls].sub(count);
+    total_free_memory_.sub(SizeClass::classToSize(cls) * count);
+    allocate_counts_[cls].add(count);
+    return count;
+}
 
-        release_count = (release_count / blocks_per_page) * blocks_per_page;
-        if (release_count == 0) continue;
+void BaseMemoryPool::deallocateRange(size_t cls, void* const* ptrs, size_t count) {
+    if (count == 0 || cls == 0 || cls >= NUM_SIZE_CLASSES) return;
 
-        // 从链表尾部找到要释放的页（需遍历链表，避免破坏链表结构）
-        FreeBlock* head = free_lists_[i];
-        FreeBlock* prev = nullptr;
-        FreeBlock* release_head = head;
-        size_t remaining = current_count - release_count;
+    // 按数组顺序串联，尾部接到原链表头
+    for (size_t i = 0; i + 1 < count; ++i) {
+        static_cast<FreeBlock*>(ptrs[i])->next = static_cast<FreeBlock*>(ptrs[i + 1]);
+    }
+    static_cast<FreeBlock*>(ptrs[count - 1])->next = free_lists_[cls];
+    free_lists_[cls] = static_cast<FreeBlock*>(ptrs[0]);
 
-        // 移动到要释放的第一个块
-        for (size_t j = 0; j < remaining - 1; ++j) {
-            if (!release_head->next) break;
-            prev = release_head;
-            release_head = release_head->next;
-        }
+    free_block_counts_[cls].add(count);
+    total_free_memory_.add(SizeClass::classToSize(cls) * count);
+    deallocate_counts_[cls].add(count);
+}
 
-        if (!release_head) continue;
+void BaseMemoryPool::pushRange(size_t cls, FreeBlock* head, FreeBlock* tail, size_t count) {
+    if (!head || count == 0) return;
+    tail->next = free_lists_[cls];
+    free_lists_[cls] = head;
 
-        // 断开链表
-        if (prev) prev->next = nullptr;
-        else free_lists_[i] = nullptr;
+    size_t bytes = SizeClass::classToSize(cls) * count;
+    free_block_counts_[cls].add(count);
+    total_free_memory_.add(bytes);
+    total_allocated_memory_.add(bytes);
+}
 
-        // 释放整页内存（所有释放的块必须连续在同一页）
-        void* page = release_head;
-        reclaimed_size += total_size * release_count;
+size_t BaseMemoryPool::popRange(size_t cls, size_t count, FreeBlock** head, FreeBlock** tail) {
+    if (count > freeCount(cls)) count = freeCount(cls);
+    if (count == 0) return 0;
+
+    // 沿链表走count-1步找到这段的尾部
+    FreeBlock* first = free_lists_[cls];
+    FreeBlock* last = first;
+    for (size_t i = 1; i < count; ++i) last = last->next;
+    free_lists_[cls] = last->next;
+    last->next = nullptr;
+    *head = first;
+    *tail = last;
+
+    size_t bytes = SizeClass::classToSize(cls) * count;
+    free_block_counts_[cls].sub(count);
+    total_free_memory_.sub(bytes);
+    total_allocated_memory_.sub(bytes);
+    return count;
+}
 
-        // 更新统计信息
-        free_block_counts_[i] -= release_count;
-        total_free_memory_ -= total_size * release_count;
+MemoryStats BaseMemoryPool::getStats() const {
+    MemoryStats stats;
+    for (size_t cls = 1; cls < NUM_SIZE_CLASSES; ++cls) {
+        stats.allocate_count += allocate_counts_[cls].get();
+        stats.deallocate_count += deallocate_counts_[cls].get();
+    }
+    stats.total_free_memory = total_free_memory_.get();
+    stats.total_allocated_memory = total_allocated_memory_.get();
+    // 其他线程释放到本池的块会使空闲内存超过取入的内存，此时使用量记为0
+    stats.total_used_memory = stats.total_allocated_memory > stats.total_free_memory
+                                  ? stats.total_allocated_memory - stats.total_free_memory
+                                  : 0;
+    return stats;
+}
 
-        // 释放内存到系统
-        free(page);
+void BaseMemoryPool::resetStats() {
+    for (size_t cls = 0; cls < NUM_SIZE_CLASSES; ++cls) {
+        allocate_counts_[cls].reset();
+        deallocate_counts_[cls].reset();
     }
+    total_free_memory_.reset();
+    total_allocated_memory_.reset();
+}
 
-    return reclaimed_size;
+// -------------------------- CentralFreeList 实现 --------------------------
+std::mutex& CentralFreeList::lock() {
+#ifdef EMA_CENTRAL_SINGLE_LOCK
+    static std::mutex single_lock;
+    return single_lock;
+#else
+    return mutex_;
+#endif
 }
 
-void* BaseMemoryPool::allocate(size_t user_size) {
-    // 超大内存直接返回nullptr（交给malloc）
-    if (user_size > MAX_USER_SIZE) return nullptr;
+bool CentralFreeList::populate(ThreadLocalMemoryPool* owner) {
+    size_t block_size = SizeClass::classToSize(cls_);
+
+    // 向页堆申请该级别对应页数的Span（页堆保证按页对齐，且这些页只属于一个Span）
+    Span* span = heap_->allocateSpan(SizeClass::classToPages(cls_));
+    if (!span) return false;
+    span->size_class = cls_;
+    span->ref_count = 0;
+    span->owner.store(owner, std::memory_order_relaxed);
+
+    // 拆分为多个块，串联为该Span的空闲链表
+    size_t block_count = span->bytes() / block_size;
+    char* base = static_cast<char*>(span->startAddress());
+    for (size_t i = 0; i + 1 < block_count; ++i) {
+        reinterpret_cast<FreeBlock*>(base + i * block_size)->next =
+            reinterpret_cast<FreeBlock*>(base + (i + 1) * block_size);
+    }
+    reinterpret_cast<FreeBlock*>(base + (block_count - 1) * block_size)->next = nullptr;
+    span->objects = reinterpret_cast<FreeBlock*>(base);
+    spanListPrepend(&nonempty_, span);
 
-    // 计算块总大小
-    size_t total_size = calcAlignedTotalSize(user_size);
-    int index = findBlockSizeIndex(total_size);
+    // 更新统计信息
+    count_ += block_count;
+    span_count_++;
+    stats_->free_bytes += block_size * block_count;
+    stats_->allocated_bytes += span->bytes();
+    return true;
+}
 
-    // 动态添加不存在的块大小
-    if (index == -1) {
-        index = addBlockSizeIfNotExist(total_size);
-        if (index == -1) return nullptr;
-    }
+size_t CentralFreeList::removeRange(size_t count, ThreadLocalMemoryPool* owner,
+                                    FreeBlock** head, FreeBlock** tail) {
+    std::lock_guard<std::mutex> guard(lock());
+
+    FreeBlock* first = nullptr;
+    FreeBlock* last = nullptr;
+    size_t fetched = 0;
+    while (fetched < count) {
+        // 没有仍有空闲块的Span时向页堆申请新Span
+        if (spanListEmpty(&nonempty_) && !populate(owner)) break;
+
+        // 从链表首个Span中尽量多取
+        Span* span = nonempty_.next;
+        while (span->objects && fetched < count) {
+            FreeBlock* block = span->objects;
+            span->objects = block->next;
+            block->next = first;
+            first = block;
+            if (!last) last = block;
+            span->ref_count++;
+            fetched++;
+        }
 
-    // 空闲链表为空时，批量分配
-    if (!free_lists_[index] && !allocateBatch(total_size, index)) {
-        return nullptr;
+        // 块已全部分出的Span移出链表，待有块归还时再挂回
+        if (!span->objects) spanListRemove(span);
     }
+    if (fetched == 0) return 0;
+    *head = first;
+    *tail = last;
+
+    count_ -= fetched;
+    fetch_count_ += fetched;
+    stats_->free_bytes -= SizeClass::classToSize(cls_) * fetched;
+    return fetched;
+}
 
-    // 从链表头取出一块
-    FreeBlock* block = free_lists_[index];
-    free_lists_[index] = block->next;
+void CentralFreeList::insertRange(FreeBlock* head, FreeBlock* tail, size_t count) {
+    if (!head || count == 0) return;
+    std::lock_guard<std::mutex> guard(lock());
 
-    // 更新统计信息
-    free_block_counts_[index]--;
-    total_free_memory_ -= block->size;
-    allocate_count_++;
+    count_ += count;
+    return_count_ += count;
+    stats_->free_bytes += SizeClass::classToSize(cls_) * count;
 
-    // 返回用户数据区指针（跳过空闲块头部）
-    return static_cast<char*>(reinterpret_cast<void*>(block)) + FREE_BLOCK_HEADER_SIZE;
+    FreeBlock* block = head;
+    for (size_t i = 0; i < count && block; ++i) {
+        FreeBlock* next = block->next;
+        releaseToSpan(block);
+        block = next;
+    }
 }
 
-void BaseMemoryPool::deallocate(void* user_ptr) {
-    if (!user_ptr) return;
+void CentralFreeList::releaseToSpan(FreeBlock* block) {
+    Span* span = PageMap::getInstance().lookup(block);
+
+    // Span此前已无空闲块：重新挂回非空链表
+    if (!span->objects) spanListPrepend(&nonempty_, span);
+    block->next = span->objects;
+    span->objects = block;
+
+    // 块已全部归还：整个Span交还页堆（由页堆合并，超限时归还系统）
+    if (--span->ref_count == 0) {
+        spanListRemove(span);
+        size_t block_size = SizeClass::classToSize(cls_);
+        size_t block_count = span->bytes() / block_size;
+        count_ -= block_count;
+        span_count_--;
+        stats_->free_bytes -= block_size * block_count;
+        stats_->allocated_bytes -= span->bytes();
+        heap_->deallocateSpan(span);
+    }
+}
 
-    // 计算块头部指针
-    FreeBlock* block = reinterpret_cast<FreeBlock*>(
-        static_cast<char*>(user_ptr) - FREE_BLOCK_HEADER_SIZE
-    );
-    size_t total_size = block->size;
+void CentralFreeList::addStats(SizeClassStats& stats) {
+    std::lock_guard<std::mutex> guard(lock());
+    stats.spans += span_count_;
+    stats.central_blocks += count_;
+    stats.central_fetch_count += fetch_count_;
+    stats.central_return_count += return_count_;
+}
 
-    // 跳过超大块（直接free）和无效块
-    if (total_size == 0 || total_size < calcAlignedTotalSize(MIN_USER_SIZE)) {
-        free(user_ptr);
-        return;
+// -------------------------- GlobalMemoryPool 实现 --------------------------
+GlobalMemoryPool& GlobalMemoryPool::getInstance(size_t node) {
+    // 每个节点一个实例，首次访问时创建且永不析构：进程退出时其他静态对象的析构函数仍可能释放内存
+    alignas(GlobalMemoryPool) static char storage[MAX_NUMA_NODES][sizeof(GlobalMemoryPool)];
+    static std::atomic<GlobalMemoryPool*> instances[MAX_NUMA_NODES];
+    static std::mutex init_mutex;
+
+    GlobalMemoryPool* pool = instances[node].load(std::memory_order_acquire);
+    if (pool) return *pool;
+    std::lock_guard<std::mutex> lock(init_mutex);
+    pool = instances[node].load(std::memory_order_relaxed);
+    if (!pool) {
+        pool = new (storage[node]) GlobalMemoryPool(node);
+        instances[node].store(pool, std::memory_order_release);
     }
+    return *pool;
+}
 
-    // 查找块大小索引
-    int index = findBlockSizeIndex(total_size);
-    if (index == -1) {
-        free(user_ptr);
-        return;
+GlobalMemoryPool::GlobalMemoryPool(size_t node) {
+    PageHeap* heap = &PageHeap::getInstance(node);
+    for (size_t cls = 1; cls < NUM_SIZE_CLASSES; ++cls) {
+        central_lists_[cls].init(cls, &stats_, heap);
     }
+}
 
-    // 将块插入链表头（高效）
-    block->next = free_lists_[index];
-    free_lists_[index] = block;
+void* GlobalMemoryPool::allocate(size_t user_size) {
+    if (user_size > MAX_USER_SIZE) return nullptr;
+    if (user_size == 0) user_size = MIN_USER_SIZE;
 
-    // 更新统计信息
-    free_block_counts_[index]++;
-    total_free_memory_ += total_size;
-    deallocate_count_++;
+    FreeBlock* head = nullptr;
+    FreeBlock* tail = nullptr;
+    if (fetchBatch(SizeClass::sizeToClass(user_size), 1, nullptr, &head, &tail) == 0) return nullptr;
+    return head;
 }
 
-void BaseMemoryPool::transferTo(BaseMemoryPool& dest) {
-    // 遍历所有空闲链表，转移到目标池
-    for (size_t i = 0; i < free_lists_.size(); ++i) {
-        if (!free_lists_[i]) continue;
+void GlobalMemoryPool::deallocate(void* user_ptr, size_t cls) {
+    if (!user_ptr || cls == 0 || cls >= NUM_SIZE_CLASSES) return;
+    FreeBlock* block = static_cast<FreeBlock*>(user_ptr);
+    block->next = nullptr;
+    returnBatch(cls, block, block, 1);
+}
 
-        size_t total_size = block_sizes_[i];
-        int dest_index = dest.findBlockSizeIndex(total_size);
+size_t GlobalMemoryPool::fetchBatch(size_t cls, size_t count, ThreadLocalMemoryPool* owner,
+                                    FreeBlock** head, FreeBlock** tail) {
+    size_t fetched = central_lists_[cls].removeRange(count, owner, head, tail);
+    allocate_count_ += fetched;
+    return fetched;
+}
 
-        // 目标池不存在该块大小，动态添加
-        if (dest_index == -1) {
-            dest_index = dest.addBlockSizeIfNotExist(total_size);
-            if (dest_index == -1) continue;
-        }
+void GlobalMemoryPool::returnBatch(size_t cls, FreeBlock* head, FreeBlock* tail, size_t count) {
+    insertRange(cls, head, tail, count);
+}
 
-        // 连接当前链表到目标链表尾部
-        FreeBlock* last = free_lists_[i];
-        while (last->next) last = last->next;
-        last->next = dest.free_lists_[dest_index];
-        dest.free_lists_[dest_index] = free_lists_[i];
+void GlobalMemoryPool::insertRange(size_t cls, FreeBlock* head, FreeBlock* tail, size_t count) {
+    if (Numa::nodeCount() == 1) {
+        central_lists_[cls].insertRange(head, tail, count);
+        deallocate_count_ += count;
+        return;
+    }
 
-        // 更新目标池统计信息
-        size_t block_count = free_block_counts_[i];
-        dest.free_block_counts_[dest_index] += block_count;
-        dest.total_free_memory_ += total_size * block_count;
+    // 多节点：线程本地链表中可能混有其他节点的块（如释放了其他节点线程分配的内存），
+    // 按所属Span的节点拆成多段，分别归还原节点的中心缓存
+    FreeBlock* heads[MAX_NUMA_NODES] = {};
+    FreeBlock* tails[MAX_NUMA_NODES] = {};
+    size_t counts[MAX_NUMA_NODES] = {};
+    PageMap& page_map = PageMap::getInstance();
+    FreeBlock* block = head;
+    for (size_t i = 0; i < count && block; ++i) {
+        FreeBlock* next = block->next;
+        size_t node = page_map.lookup(block)->node;
+        block->next = heads[node];
+        if (!heads[node]) tails[node] = block;
+        heads[node] = block;
+        counts[node]++;
+        block = next;
+    }
+    for (size_t node = 0; node < MAX_NUMA_NODES; ++node) {
+        if (counts[node] == 0) continue;
+        GlobalMemoryPool& home = getInstance(node);
+        home.central_lists_[cls].insertRange(heads[node], tails[node], counts[node]);
+        home.deallocate_count_ += counts[node];
+    }
+}
 
-        // 清空当前池链表
-        free_lists_[i] = nullptr;
-        free_block_counts_[i] = 0;
-        total_free_memory_ -= total_size * block_count;
+void GlobalMemoryPool::transferFrom(BaseMemoryPool& src) {
+    // 逐级别转移，每次只持有对应级别的锁
+    for (size_t cls = 1; cls < NUM_SIZE_CLASSES; ++cls) {
+        FreeBlock* head = nullptr;
+        FreeBlock* tail = nullptr;
+        size_t count = src.popRange(cls, src.freeCount(cls), &head, &tail);
+        if (count == 0) continue;
+        insertRange(cls, head, tail, count);
     }
 }
 
-MemoryStats BaseMemoryPool::getStats() const {
+MemoryStats GlobalMemoryPool::getGlobalStats() {
     MemoryStats stats;
     stats.allocate_count = allocate_count_;
     stats.deallocate_count = deallocate_count_;
-    stats.total_free_memory = total_free_memory_;
-    stats.total_allocated_memory = total_allocated_memory_;
-    stats.total_used_memory = total_allocated_memory_ - total_free_memory_;
+    stats.total_free_memory = stats_.free_bytes;
+    stats.total_allocated_memory = stats_.allocated_bytes;
+    stats.total_used_memory = stats.total_allocated_memory - stats.total_free_memory;
     return stats;
 }
 
-// -------------------------- GlobalMemoryPool 实现 --------------------------
-GlobalMemoryPool& GlobalMemoryPool::getInstance() {
-    static GlobalMemoryPool instance; // C++11线程安全单例
-    return instance;
+// -------------------------- ThreadLocalMemoryPool 实现 --------------------------
+// 本地池实例注册表：实例只创建不销毁，线程退出后进入空闲链表等待复用
+static std::mutex& threadPoolRegistryMutex() {
+    static std::mutex mutex;
+    return mutex;
 }
 
-void* GlobalMemoryPool::allocate(size_t user_size) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return pool_.allocate(user_size);
+static MetadataAllocator<ThreadLocalMemoryPool>& threadPoolAllocator() {
+    static MetadataAllocator<ThreadLocalMemoryPool> allocator;
+    return allocator;
 }
 
-void GlobalMemoryPool::deallocate(void* user_ptr) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    pool_.deallocate(user_ptr);
+static ThreadLocalMemoryPool* free_thread_pools = nullptr; // 已退出线程留下的实例
+static ThreadLocalMemoryPool* all_thread_pools = nullptr;  // 已创建的全部实例
+static MemoryStats retired_thread_stats;                   // 已退出线程累计的分配/释放次数
+static size_t retired_class_allocs[NUM_SIZE_CLASSES];      // 已退出线程按级别累计的分配/释放次数
+static size_t retired_class_frees[NUM_SIZE_CLASSES];
 
-    // 检查是否需要回收内存
-    if (pool_.getStats().total_free_memory > MAX_GLOBAL_FREE_MEMORY) {
-        size_t reclaimed = pool_.reclaimIdleMemory();
-        if (reclaimed > 0) {
-            // 可选：打印回收日志（生产环境可关闭）
-            // std::cout << "[GlobalPool] Reclaimed " << reclaimed << " bytes\n";
-        }
+ThreadLocalMemoryPool::ThreadLocalMemoryPool() {
+    resetListLengths();
+}
+
+void ThreadLocalMemoryPool::resetListLengths() {
+    for (size_t cls = 0; cls < NUM_SIZE_CLASSES; ++cls) {
+        max_lengths_[cls] = 1;
+        length_overages_[cls] = 0;
     }
 }
 
-void GlobalMemoryPool::transferFrom(BaseMemoryPool& src) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    src.transferTo(pool_);
+void ThreadLocalMemoryPool::bindNode(size_t node) {
+    node_ = node;
+    central_ = &GlobalMemoryPool::getInstance(node);
+}
 
-    // 转移后检查是否需要回收内存
-    if (pool_.getStats().total_free_memory > MAX_GLOBAL_FREE_MEMORY) {
-        pool_.reclaimIdleMemory();
+ThreadLocalMemoryPool* ThreadLocalMemoryPool::acquire() {
+    // 新线程可能位于其他节点：先确定节点并创建该节点的全局池（持注册表锁时只做绑定）
+    size_t node = Numa::currentNode();
+    GlobalMemoryPool::getInstance(node);
+
+    ThreadLocalMemoryPool* pool = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(threadPoolRegistryMutex());
+        if (free_thread_pools) {
+            pool = free_thread_pools;
+            free_thread_pools = pool->next_free_;
+            pool->next_free_ = nullptr;
+            pool->active_ = true;
+            pool->bindNode(node);
+        }
+    }
+    if (!pool) {
+        pool = threadPoolAllocator().allocate();
+        if (!pool) return nullptr;
+        pool->bindNode(node);
+        std::lock_guard<std::mutex> lock(threadPoolRegistryMutex());
+        pool->active_ = true;
+        pool->next_all_ = all_thread_pools;
+        all_thread_pools = pool;
+        return pool;
     }
-}
 
-MemoryStats GlobalMemoryPool::getGlobalStats() {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return pool_.getStats();
+    // 复用实例：重新打开远程释放队列，链表上限重新慢启动
+    pool->remote_free_head_.store(nullptr, std::memory_order_release);
+    pool->resetListLengths();
+    return pool;
 }
 
-// -------------------------- ThreadLocalMemoryPool 实现 --------------------------
-ThreadLocalMemoryPool::~ThreadLocalMemoryPool() {
-    // 线程退出时，将本地池内存转移到全局池
-    GlobalMemoryPool::getInstance().transferFrom(pool_);
+void ThreadLocalMemoryPool::release(ThreadLocalMemoryPool* pool) {
+    // 关闭远程释放队列：此后其他线程的释放改走各自的本地池
+    FreeBlock* remote = pool->remote_free_head_.exchange(REMOTE_FREE_CLOSED, std::memory_order_acquire);
+    PageMap& page_map = PageMap::getInstance();
+    while (remote) {
+        FreeBlock* next = remote->next;
+        pool->pool_.deallocate(remote, page_map.lookup(remote)->size_class);
+        remote = next;
+    }
+
+    // 线程退出时，将本地池内存转移到所属节点的全局池（其他节点的块回到各自节点）
+    pool->central_->transferFrom(pool->pool_);
+
+    // 次数并入退出线程累计值后清零，复用实例的线程从0开始计数
+    std::lock_guard<std::mutex> lock(threadPoolRegistryMutex());
+    MemoryStats stats = pool->pool_.getStats();
+    retired_thread_stats.allocate_count += stats.allocate_count;
+    retired_thread_stats.deallocate_count += stats.deallocate_count;
+    for (size_t cls = 1; cls < NUM_SIZE_CLASSES; ++cls) {
+        retired_class_allocs[cls] += pool->pool_.allocateCount(cls);
+        retired_class_frees[cls] += pool->pool_.deallocateCount(cls);
+    }
+    pool->pool_.resetStats();
+    pool->active_ = false;
+    pool->next_free_ = free_thread_pools;
+    free_thread_pools = pool;
 }
 
 void* ThreadLocalMemoryPool::allocate(size_t user_size) {
+    // 1. 本地空闲链表
+    void* p = pool_.allocate(user_size);
+    if (p || user_size > MAX_USER_SIZE) return p;
+
+    // 2. 本地链表为空：批量取回其他线程释放的块后重试
+    if (drainRemoteFrees() > 0) {
+        p = pool_.allocate(user_size);
+        if (p) return p;
+    }
+
+    // 3. 从中心缓存批量取一批块（中心缓存不足时切分新页，Span归属本池）
+    size_t cls = SizeClass::sizeToClass(user_size == 0 ? MIN_USER_SIZE : user_size);
+    if (!fetchFromCentral(cls)) return nullptr;
     return pool_.allocate(user_size);
 }
 
-void ThreadLocalMemoryPool::deallocate(void* user_ptr) {
-    return pool_.deallocate(user_ptr);
+void ThreadLocalMemoryPool::deallocate(void* user_ptr, size_t cls) {
+    pool_.deallocate(user_ptr, cls);
+    if (pool_.freeCount(cls) > max_lengths_[cls]) listTooLong(cls);
+}
+
+bool ThreadLocalMemoryPool::fetchFromCentral(size_t cls) {
+    size_t batch = SizeClass::numToMove(cls);
+    size_t& max_length = max_lengths_[cls];
+    size_t want = max_length < batch ? max_length : batch;
+
+    FreeBlock* head = nullptr;
+    FreeBlock* tail = nullptr;
+    size_t count = central_->fetchBatch(cls, want, this, &head, &tail);
+    if (count == 0) return false;
+    pool_.pushRange(cls, head, tail, count);
+
+    // 慢启动：上限不足一批时逐个增长，达到一批后按批增长
+    if (max_length < batch) {
+        max_length++;
+    } else {
+        size_t limit = SizeClass::maxListLength(cls);
+        max_length = max_length + batch > limit ? limit : max_length + batch;
+    }
+    return true;
+}
+
+void ThreadLocalMemoryPool::listTooLong(size_t cls) {
+    // 一次性归还一半（链表在本地摘下，中心缓存加锁后O(1)拼接）
+    size_t release = pool_.freeCount(cls) / 2;
+    if (release == 0) release = 1;
+    FreeBlock* head = nullptr;
+    FreeBlock* tail = nullptr;
+    size_t count = pool_.popRange(cls, release, &head, &tail);
+    central_->returnBatch(cls, head, tail, count);
+
+    size_t batch = SizeClass::numToMove(cls);
+    size_t& max_length = max_lengths_[cls];
+    if (max_length < batch) {
+        // 仍在慢启动阶段：继续增长
+        max_length++;
+    } else if (max_length > batch && ++length_overages_[cls] > MAX_LIST_OVERAGES) {
+        // 频繁超限说明缓存过大：收缩一批
+        max_length -= batch;
+        length_overages_[cls] = 0;
+    }
+
+    // 本线程正在大量释放：顺带取回远程释放的块，使其所在Span能尽快整体交还页堆
+    drainRemoteFrees();
+}
+
+size_t ThreadLocalMemoryPool::allocateBatch(size_t cls, size_t count, void** out) {
+    // 1. 本地链表（不足时先取回远程释放的块）
+    if (pool_.freeCount(cls) < count) drainRemoteFrees();
+    size_t done = pool_.allocateRange(cls, count, out);
+    if (done == count) return done;
+
+    // 2. 不足部分一次性从中心缓存取齐（可跨多个Span，不受慢启动上限限制）
+    FreeBlock* head = nullptr;
+    FreeBlock* tail = nullptr;
+    size_t fetched = central_->fetchBatch(cls, count - done, this, &head, &tail);
+    if (fetched == 0) return done;
+    pool_.pushRange(cls, head, tail, fetched);
+    return done + pool_.allocateRange(cls, count - done, out + done);
+}
+
+void ThreadLocalMemoryPool::deallocateBatch(size_t cls, void* const* ptrs, size_t count) {
+    pool_.deallocateRange(cls, ptrs, count);
+
+    // 超出上限的部分一次归还中心缓存（与listTooLong不同，整批释放不调整上限）
+    size_t free_count = pool_.freeCount(cls);
+    if (free_count <= max_lengths_[cls]) return;
+    FreeBlock* head = nullptr;
+    FreeBlock* tail = nullptr;
+    size_t released = pool_.popRange(cls, free_count - max_lengths_[cls], &head, &tail);
+    central_->returnBatch(cls, head, tail, released);
+    drainRemoteFrees();
+}
+
+void ThreadLocalMemoryPool::flush() {
+    drainRemoteFrees();
+    central_->transferFrom(pool_);
+}
+
+bool ThreadLocalMemoryPool::pushRemoteFree(void* user_ptr) {
+    FreeBlock* block = static_cast<FreeBlock*>(user_ptr);
+    FreeBlock* head = remote_free_head_.load(std::memory_order_relaxed);
+    do {
+        if (head == REMOTE_FREE_CLOSED) return false;
+        block->next = head;
+    } while (!remote_free_head_.compare_exchange_weak(head, block, std::memory_order_release,
+                                                      std::memory_order_relaxed));
+    return true;
+}
+
+size_t ThreadLocalMemoryPool::drainRemoteFrees() {
+    // 取回过程中释放可能再次触发listTooLong，避免重入
+    if (draining_ || !remote_free_head_.load(std::memory_order_relaxed)) return 0;
+    draining_ = true;
+
+    // 整条链一次性摘下（仅消费者执行exchange，不存在ABA问题）
+    FreeBlock* block = remote_free_head_.exchange(nullptr, std::memory_order_acquire);
+    PageMap& page_map = PageMap::getInstance();
+    size_t count = 0;
+    while (block) {
+        FreeBlock* next = block->next;
+        deallocate(block, page_map.lookup(block)->size_class);
+        block = next;
+        count++;
+    }
+    draining_ = false;
+    return count;
 }
 
 MemoryStats ThreadLocalMemoryPool::getLocalStats() const {
     return pool_.getStats();
 }
 
+MemoryStats ThreadLocalMemoryPool::getAllLocalStats() {
+    std::lock_guard<std::mutex> lock(threadPoolRegistryMutex());
+    MemoryStats total = retired_thread_stats;
+    for (ThreadLocalMemoryPool* pool = all_thread_pools; pool; pool = pool->next_all_) {
+        MemoryStats stats = pool->pool_.getStats();
+        total.allocate_count += stats.allocate_count;
+        total.deallocate_count += stats.deallocate_count;
+        total.total_free_memory += stats.total_free_memory;
+    }
+    return total;
+}
+
+void ThreadLocalMemoryPool::addSizeClassStats(SizeClassStats* stats) {
+    std::lock_guard<std::mutex> lock(threadPoolRegistryMutex());
+    for (size_t cls = 1; cls < NUM_SIZE_CLASSES; ++cls) {
+        stats[cls].allocate_count += retired_class_allocs[cls];
+        stats[cls].deallocate_count += retired_class_frees[cls];
+    }
+    for (ThreadLocalMemoryPool* pool = all_thread_pools; pool; pool = pool->next_all_) {
+        for (size_t cls = 1; cls < NUM_SIZE_CLASSES; ++cls) {
+            stats[cls].allocate_count += pool->pool_.allocateCount(cls);
+            stats[cls].deallocate_count += pool->pool_.deallocateCount(cls);
+            stats[cls].thread_cache_blocks += pool->pool_.freeCount(cls);
+        }
+    }
+}
+
+size_t ThreadLocalMemoryPool::getThreadCacheStats(ThreadCacheStats* out, size_t max_count) {
+    std::lock_guard<std::mutex> lock(threadPoolRegistryMutex());
+    size_t total = 0;
+    for (ThreadLocalMemoryPool* pool = all_thread_pools; pool; pool = pool->next_all_, ++total) {
+        if (!out || total >= max_count) continue;
+        ThreadCacheStats& stats = out[total];
+        MemoryStats local = pool->pool_.getStats();
+        stats.active = pool->active_;
+        stats.node = pool->node_;
+        stats.allocate_count = local.allocate_count;
+        stats.deallocate_count = local.deallocate_count;
+        stats.free_bytes = 0;
+        for (size_t cls = 0; cls < NUM_SIZE_CLASSES; ++cls) {
+            stats.free_blocks[cls] = cls == 0 ? 0 : pool->pool_.freeCount(cls);
+            stats.free_bytes += stats.free_blocks[cls] * SizeClass::classToSize(cls);
+        }
+    }
+    return total;
+}
+
 // -------------------------- MemoryManager 实现 --------------------------
+ThreadLocalMemoryPool& MemoryManager::localPool() {
+    if (local_pool_) return *local_pool_;
+
+    // 线程退出回调借助pthread key注册（key在进程内只创建一次）
+    static pthread_key_t exit_key;
+    static bool key_created = (pthread_key_create(&exit_key, &MemoryManager::onThreadExit) == 0);
+
+    local_pool_ = ThreadLocalMemoryPool::acquire();
+    if (key_created) pthread_setspecific(exit_key, local_pool_);
+    return *local_pool_;
+}
+
+void MemoryManager::onThreadExit(void* pool) {
+    local_pool_ = nullptr;
+    ThreadLocalMemoryPool::release(static_cast<ThreadLocalMemoryPool*>(pool));
+}
+
+void* MemoryManager::cacheAllocate(size_t user_size) {
+    if (PerCpuCache::enabled() && user_size <= MAX_USER_SIZE) {
+        void* p = PerCpuCache::allocate(SizeClass::sizeToClass(user_size == 0 ? MIN_USER_SIZE : user_size));
+        if (p) return p;
+    }
+    return localPool().allocate(user_size);
+}
+
+void MemoryManager::cacheDeallocate(void* user_ptr, size_t cls) {
+    if (PerCpuCache::enabled() && PerCpuCache::deallocate(user_ptr, cls)) return;
+    localPool().deallocate(user_ptr, cls);
+}
+
+size_t MemoryManager::currentNode() {
+    return PerCpuCache::enabled() ? Numa::currentNode() : localPool().node();
+}
+
+// 慢路径不内联：保持allocate快速路径紧凑，调用栈中的帧数也固定
+__attribute__((noinline)) void* MemoryManager::allocateSampled(size_t user_size) {
+    if (!HeapProfiler::takeSample() || user_size > SIZE_MAX - PAGE_SIZE) return nullptr;
+    size_t pages = user_size == 0 ? 1 : (user_size + PAGE_SIZE - 1) >> PAGE_SHIFT;
+    Span* span = PageHeap::getInstance(currentNode()).allocateSpan(pages);
+    if (!span) return nullptr;
+    HeapProfiler::recordAllocation(span, user_size);
+    return span->startAddress();
+}
+
 void* MemoryManager::allocate(size_t user_size) {
-    // 1. 优先从【共享的线程本地池】分配（无锁）
-    void* p = local_pool_.allocate(user_size);
-    if (p) return p;
+    // 0. 堆分析：未抽中时只扣减线程本地倒计数
+    if (HeapProfiler::countdown(user_size)) {
+        void* p = allocateSampled(user_size);
+        if (p) return p;
+    }
 
-    // 2. 本地池不足，从全局池分配（加锁）
-    p = GlobalMemoryPool::getInstance().allocate(user_size);
+    // 1. 优先从缓存分配：每CPU缓存（启用时）或【共享的线程本地池】（无锁；未命中时从中心缓存批量补充）
+    void* p = cacheAllocate(user_size);
     if (p) return p;
 
-    // 3. 全局池不足，直接malloc（对齐处理）
+    // 2. 超大内存：从本线程所在节点的页堆分配整段页（级别0，释放时整体归还所属页堆）
+    if (user_size > MAX_USER_SIZE && user_size <= SIZE_MAX - PAGE_SIZE) {
+        Span* span = PageHeap::getInstance(currentNode()).allocateSpan((user_size + PAGE_SIZE - 1) >> PAGE_SHIFT);
+        if (span) return span->startAddress();
+    }
+
+#ifdef EMA_INTERPOSE
+    // 作为malloc替代时没有可退回的系统分配器
+    return nullptr;
+#else
+    // 3. 页堆无法分配，直接malloc（对齐处理）
     size_t aligned_size = alignUp(user_size, BLOCK_ALIGNMENT);
     return malloc(aligned_size);
+#endif
+}
+
+void* MemoryManager::allocateAligned(size_t user_size, size_t alignment) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) return nullptr;
+
+    // 16字节及以上的级别都按MALLOC_ALIGNMENT对齐，更小的请求提升到对齐大小即可
+    if (alignment <= MALLOC_ALIGNMENT) {
+        if (alignment > BLOCK_ALIGNMENT && user_size < alignment) user_size = alignment;
+        return allocate(user_size);
+    }
+
+    // 1. 池化：选取大小为alignment整数倍的级别（Span按页对齐，块地址天然对齐）
+    size_t request = user_size < alignment ? alignment : user_size;
+    if (alignment <= PAGE_SIZE && request <= MAX_USER_SIZE) {
+        size_t cls = SizeClass::alignedClass(request, alignment);
+        if (cls != 0) {
+            void* p = cacheAllocate(SizeClass::classToSize(cls));
+            if (p) return p;
+        }
+    }
+
+    // 2. 整页Span：起始地址已按页对齐，更大的对齐多申请(alignment - PAGE_SIZE)字节后取内部对齐地址
+    size_t extra = alignment > PAGE_SIZE ? alignment - PAGE_SIZE : 0;
+    if (request <= SIZE_MAX - extra - PAGE_SIZE) {
+        Span* span = PageHeap::getInstance(currentNode()).allocateSpan((request + extra + PAGE_SIZE - 1) >> PAGE_SHIFT);
+        if (span) {
+            uintptr_t start = reinterpret_cast<uintptr_t>(span->startAddress());
+            return reinterpret_cast<void*>((start + alignment - 1) & ~(alignment - 1));
+        }
+    }
+
+#ifdef EMA_INTERPOSE
+    return nullptr;
+#else
+    // 3. 页堆无法分配，退回系统的对齐分配（释放时未登记的内存直接free）
+    void* p = nullptr;
+    return posix_memalign(&p, alignment < sizeof(void*) ? sizeof(void*) : alignment, user_size) == 0 ? p : nullptr;
+#endif
 }
 
 void MemoryManager::deallocate(void* user_ptr) {
     if (!user_ptr) return;
 
-    // 尝试释放到【共享的线程本地池】（无锁）
-    local_pool_.deallocate(user_ptr);
+    // 经PageMap分类：未登记的页来自malloc（页堆无法分配时的退路），直接free
+    // 作为malloc替代时不存在这类内存，未登记的指针直接忽略
+    Span* span = PageMap::getInstance().lookup(user_ptr);
+    if (!span) {
+#ifndef EMA_INTERPOSE
+        free(user_ptr);
+#endif
+        return;
+    }
+
+    // 超大内存（及堆分析抽中的分配）：整个Span直接交还所属页堆
+    if (span->size_class == 0) {
+        if (span->sample) HeapProfiler::recordFree(span);
+        PageHeap::forSpan(span).deallocateSpan(span);
+        return;
+    }
+
+    // 每CPU缓存模式：直接放入当前CPU的缓存（不区分所属线程）
+    if (PerCpuCache::enabled() && PerCpuCache::deallocate(user_ptr, span->size_class)) return;
+
+    // 块属于其他线程：推入其远程释放队列（无锁），由所属线程下次分配未命中时批量取回
+    ThreadLocalMemoryPool& local = localPool();
+    ThreadLocalMemoryPool* owner = span->owner.load(std::memory_order_relaxed);
+    if (owner && owner != &local) {
+        if (owner->pushRemoteFree(user_ptr)) return;
+        // 所属线程已退出：清除归属，之后该Span的块直接在释放线程本地回收
+        span->owner.compare_exchange_strong(owner, nullptr, std::memory_order_relaxed);
+    }
+
+    // 池化内存释放到【共享的线程本地池】（无锁）
+    local.deallocate(user_ptr, span->size_class);
+}
+
+void MemoryManager::deallocate(void* user_ptr, size_t user_size) {
+    if (!user_ptr) return;
+    // 抽中的分配不论大小都独占Span，开启过堆分析后须经PageMap识别
+    if (user_size > MAX_USER_SIZE || HeapProfiler::everEnabled()) return deallocate(user_ptr);
+
+    // 块可以归还到任意线程的本地池（中心缓存按Span计数），因此无需查询所属线程
+    if (user_size == 0) user_size = MIN_USER_SIZE;
+    cacheDeallocate(user_ptr, SizeClass::sizeToClass(user_size));
+}
+
+size_t MemoryManager::allocateBatch(size_t user_size, size_t count, void** out) {
+    if (!out || count == 0) return 0;
+
+    // 超大内存没有可批量拼接的链表，每CPU缓存的链表也只能逐块操作：逐个分配
+    if (user_size > MAX_USER_SIZE || PerCpuCache::enabled()) {
+        size_t done = 0;
+        while (done < count && (out[done] = allocate(user_size)) != nullptr) ++done;
+        return done;
+    }
+
+    if (user_size == 0) user_size = MIN_USER_SIZE;
+    return localPool().allocateBatch(SizeClass::sizeToClass(user_size), count, out);
+}
+
+void MemoryManager::deallocateBatch(void* const* ptrs, size_t count, size_t user_size) {
+    if (!ptrs || count == 0) return;
+    if (user_size > MAX_USER_SIZE || HeapProfiler::everEnabled()) {
+        for (size_t i = 0; i < count; ++i) deallocate(ptrs[i]);
+        return;
+    }
+    if (PerCpuCache::enabled()) {
+        for (size_t i = 0; i < count; ++i) deallocate(ptrs[i], user_size);
+        return;
+    }
+
+    // 同按大小释放：块直接进入当前线程的本地池，无需查询PageMap
+    if (user_size == 0) user_size = MIN_USER_SIZE;
+    localPool().deallocateBatch(SizeClass::sizeToClass(user_size), ptrs, count);
+}
+
+void* MemoryManager::reallocate(void* user_ptr, size_t new_size) {
+    if (!user_ptr) return allocate(new_size);
+    if (new_size == 0) {
+        deallocate(user_ptr);
+        return nullptr;
+    }
+
+    Span* span = PageMap::getInstance().lookup(user_ptr);
+    if (!span) {
+#ifdef EMA_INTERPOSE
+        return nullptr;
+#else
+        // 来自malloc的内存（页堆无法分配时的退路）交还系统realloc
+        return realloc(user_ptr, new_size);
+#endif
+    }
+
+    size_t old_size = usableSize(user_ptr);
+    if (span->size_class != 0) {
+        // 池化块：仍放得下且不会浪费过半时原样返回
+        if (new_size <= old_size && new_size >= old_size / 2) return user_ptr;
+    } else if (new_size > MAX_USER_SIZE && !span->sample) {
+        // 超大内存：按需要的页数原地收缩或扩展（对齐分配返回的指针可能位于Span内部）
+        // 堆分析抽中的分配不原地调整，总是拷贝到新内存，原Span的抽样记录随释放移除
+        size_t offset = static_cast<char*>(user_ptr) - static_cast<char*>(span->startAddress());
+        if (new_size <= SIZE_MAX - offset - PAGE_SIZE) {
+            size_t pages = (offset + new_size + PAGE_SIZE - 1) >> PAGE_SHIFT;
+            if (PageHeap::forSpan(span).resizeSpan(span, pages)) return user_ptr;
+        }
+        if (new_size <= old_size) return user_ptr;
+    }
+
+    // 无法原地完成：分配新内存并拷贝
+    void* p = allocate(new_size);
+    if (!p) return nullptr;
+    memcpy(p, user_ptr, old_size < new_size ? old_size : new_size);
+    deallocate(user_ptr);
+    return p;
+}
+
+size_t MemoryManager::usableSize(void* user_ptr) {
+    if (!user_ptr) return 0;
+    Span* span = PageMap::getInstance().lookup(user_ptr);
+    if (!span) {
+#ifdef EMA_INTERPOSE
+        return 0;
+#else
+        return malloc_usable_size(user_ptr);
+#endif
+    }
+    if (span->size_class != 0) return SizeClass::classToSize(span->size_class);
+
+    // 超大内存：指针到Span末尾的字节数
+    return static_cast<char*>(span->startAddress()) + span->bytes() - static_cast<char*>(user_ptr);
 }
 
 MemoryStats MemoryManager::getGlobalStats() {
-    return GlobalMemoryPool::getInstance().getGlobalStats();
+    // 次数来自各线程本地池；空闲内存 = 线程本地缓存 + 每CPU缓存 + 中心缓存 + 页堆驻留的空闲页；
+    // 总内存为页堆当前驻留的内存（已申请减去已归还系统的部分）
+    MemoryStats stats = ThreadLocalMemoryPool::getAllLocalStats();
+    stats.total_free_memory += PerCpuCache::freeBytes();
+    stats.total_allocated_memory = 0;
+    for (size_t node = 0; node < Numa::nodeCount(); ++node) {
+        MemoryStats central = GlobalMemoryPool::getInstance(node).getGlobalStats();
+        PageHeapStats heap = PageHeap::getInstance(node).getStats();
+        stats.total_free_memory += central.total_free_memory + heap.free_bytes;
+        stats.total_allocated_memory += heap.system_bytes - heap.released_bytes;
+    }
+    stats.total_used_memory = stats.total_allocated_memory > stats.total_free_memory
+                                  ? stats.total_allocated_memory - stats.total_free_memory
+                                  : 0;
+    return stats;
+}
+
+size_t MemoryManager::purge() {
+    if (local_pool_) local_pool_->flush();
+    PerCpuCache::drainCurrentCpu();
+    size_t released = 0;
+    for (size_t node = 0; node < Numa::nodeCount(); ++node) {
+        released += PageHeap::getInstance(node).releaseFreePages(0);
+    }
+    return released;
+}
+
+void MemoryManager::setDecayTime(long decay_ms) {
+    for (size_t node = 0; node < Numa::nodeCount(); ++node) PageHeap::getInstance(node).setDecayTime(decay_ms);
+}
+
+void MemoryManager::setRetainedMemoryCap(size_t bytes) {
+    // 上限对每个节点的页堆分别生效
+    for (size_t node = 0; node < Numa::nodeCount(); ++node) PageHeap::getInstance(node).setRetainedCap(bytes);
+}
+
+bool MemoryManager::setChunkProvider(ChunkProvider* provider) {
+    bool ok = true;
+    for (size_t node = 0; node < Numa::nodeCount(); ++node) {
+        ok = PageHeap::getInstance(node).setChunkProvider(provider) && ok;
+    }
+    return ok;
+}
+
+bool MemoryManager::startBackgroundPurge() {
+    bool ok = true;
+    for (size_t node = 0; node < Numa::nodeCount(); ++node) {
+        ok = PageHeap::getInstance(node).startBackgroundPurge() && ok;
+    }
+    return ok;
+}
+
+void MemoryManager::stopBackgroundPurge() {
+    for (size_t node = 0; node < Numa::nodeCount(); ++node) PageHeap::getInstance(node).stopBackgroundPurge();
 }
 
 MemoryStats MemoryManager::getLocalStats() {
     // 访问共享的线程本地池统计
-    return local_pool_.getLocalStats();
-}
\ No newline at end of file
+    return localPool().getLocalStats();
+}
+
+void MemoryManager::getSizeClassStats(SizeClassStats* out) {
+    if (!out) return;
+    for (size_t cls = 0; cls < NUM_SIZE_CLASSES; ++cls) {
+        out[cls] = SizeClassStats();
+        if (cls == 0) continue;
+        out[cls].block_size = SizeClass::classToSize(cls);
+        out[cls].span_pages = SizeClass::classToPages(cls);
+        out[cls].per_cpu_blocks = PerCpuCache::freeBlocks(cls);
+    }
+    ThreadLocalMemoryPool::addSizeClassStats(out);
+    for (size_t node = 0; node < Numa::nodeCount(); ++node) {
+        GlobalMemoryPool& central = GlobalMemoryPool::getInstance(node);
+        for (size_t cls = 1; cls < NUM_SIZE_CLASSES; ++cls) central.addSizeClassStats(cls, out[cls]);
+    }
+
+    // 由Span数推算容量：使用中的块 = 容量 - 各级缓存中的空闲块；Span末尾不足一块的部分为内部浪费
+    for (size_t cls = 1; cls < NUM_SIZE_CLASSES; ++cls) {
+        SizeClassStats& stats = out[cls];
+        size_t bytes_per_span = stats.span_pages << PAGE_SHIFT;
+        size_t blocks_per_span = bytes_per_span / stats.block_size;
+        size_t capacity = stats.spans * blocks_per_span;
+        size_t cached = stats.thread_cache_blocks + stats.per_cpu_blocks + stats.central_blocks;
+        stats.span_bytes = stats.spans * bytes_per_span;
+        stats.in_use_blocks = capacity > cached ? capacity - cached : 0;
+        stats.tail_waste_bytes = stats.spans * (bytes_per_span - blocks_per_span * stats.block_size);
+        stats.cached_free_bytes = cached * stats.block_size;
+    }
+}
+
+size_t MemoryManager::getThreadCacheStats(ThreadCacheStats* out, size_t max_count) {
+    return ThreadLocalMemoryPool::getThreadCacheStats(out, max_count);
+}
+
+PageSummary MemoryManager::getPageSummary() {
+    PageSummary summary;
+    for (size_t node = 0; node < Numa::nodeCount(); ++node) {
+        PageHeapStats heap = PageHeap::getInstance(node).getStats();
+        summary.mapped_bytes += heap.system_bytes;
+        summary.released_bytes += heap.released_bytes;
+        summary.page_heap_free_bytes += heap.free_bytes;
+        summary.small_span_bytes += GlobalMemoryPool::getInstance(node).getGlobalStats().total_allocated_memory;
+    }
+    summary.resident_bytes = summary.mapped_bytes - summary.released_bytes;
+
+    // 驻留且不在页堆空闲链表中的页，除去池化Span即为超大内存
+    size_t spans = summary.resident_bytes - summary.page_heap_free_bytes;
+    summary.large_span_bytes = spans > summary.small_span_bytes ? spans - summary.small_span_bytes : 0;
+    return summary;
+}
+
+std::string MemoryManager::dumpStats() {
+    // 快照在格式化之前取完（格式化本身会分配内存）
+    SizeClassStats classes[NUM_SIZE_CLASSES];
+    getSizeClassStats(classes);
+    PageSummary pages = getPageSummary();
+    std::vector<ThreadCacheStats> caches(getThreadCacheStats(nullptr, 0));
+    caches.resize(std::min(caches.size(), getThreadCacheStats(caches.data(), caches.size())));
+
+    const double MIB = 1024.0 * 1024.0;
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(1);
+    oss << std::string(100, '-') << "\n";
+    oss << "EMA memory statistics\n";
+    oss << "  Mapped:          " << std::setw(14) << pages.mapped_bytes << " B (" << pages.mapped_bytes / MIB << " MiB)\n";
+    oss << "  Resident:        " << std::setw(14) << pages.resident_bytes << " B (" << pages.resident_bytes / MIB << " MiB)\n";
+    oss << "  Released:        " << std::setw(14) << pages.released_bytes << " B (" << pages.released_bytes / MIB << " MiB)\n";
+    oss << "  Page heap free:  " << std::setw(14) << pages.page_heap_free_bytes << " B\n";
+    oss << "  Pooled spans:    " << std::setw(14) << pages.small_span_bytes << " B\n";
+    oss << "  Large spans:     " << std::setw(14) << pages.large_span_bytes << " B\n";
+
+    size_t in_use = 0;
+    size_t cached = 0;
+    size_t waste = 0;
+    for (size_t cls = 1; cls < NUM_SIZE_CLASSES; ++cls) {
+        in_use += classes[cls].in_use_blocks * classes[cls].block_size;
+        cached += classes[cls].cached_free_bytes;
+        waste += classes[cls].tail_waste_bytes;
+    }
+    oss << "  Pooled in use:   " << std::setw(14) << in_use << " B\n";
+    oss << "  Pooled cached:   " << std::setw(14) << cached << " B (thread/per-CPU/central free lists)\n";
+    oss << "  Span tail waste: " << std::setw(14) << waste << " B\n";
+
+    oss << std::string(100, '-') << "\n";
+    oss << "class    size pages   spans    in_use  thread  percpu central      allocs       frees  tail_waste  "
+           "cached_free  frag%\n";
+    for (size_t cls = 1; cls < NUM_SIZE_CLASSES; ++cls) {
+        const SizeClassStats& c = classes[cls];
+        if (c.spans == 0 && c.allocate_count == 0) continue;
+        double frag = c.span_bytes ? 100.0 * static_cast<double>(c.cached_free_bytes) / static_cast<double>(c.span_bytes) : 0;
+        oss << std::setw(5) << cls << std::setw(8) << c.block_size << std::setw(6) << c.span_pages
+            << std::setw(8) << c.spans << std::setw(10) << c.in_use_blocks << std::setw(8) << c.thread_cache_blocks
+            << std::setw(8) << c.per_cpu_blocks << std::setw(8) << c.central_blocks << std::setw(12)
+            << c.allocate_count << std::setw(12) << c.deallocate_count << std::setw(12) << c.tail_waste_bytes
+            << std::setw(13) << c.cached_free_bytes << std::setw(7) << frag << "\n";
+    }
+
+    oss << std::string(100, '-') << "\n";
+    size_t active = 0;
+    for (const ThreadCacheStats& cache : caches) active += cache.active ? 1 : 0;
+    oss << "Thread caches: " << caches.size() << " (" << active << " active)\n";
+    for (size_t i = 0; i < caches.size(); ++i) {
+        const ThreadCacheStats& cache = caches[i];
+        oss << "  [" << i << "] " << (cache.active ? "active" : "idle  ") << " node=" << cache.node
+            << " allocs=" << cache.allocate_count << " frees=" << cache.deallocate_count
+            << " free=" << cache.free_bytes << " B";
+        for (size_t cls = 1; cls < NUM_SIZE_CLASSES; ++cls) {
+            if (cache.free_blocks[cls]) oss << " " << SizeClass::classToSize(cls) << "x" << cache.free_blocks[cls];
+        }
+        oss << "\n";
+    }
+    oss << std::string(100, '-') << "\n";
+    return oss.str();
+}
+
+bool MemoryManager::enablePerCpuCache() {
+    return PerCpuCache::enable();
+}
+
+bool MemoryManager::startHeapProfiling(size_t mean_interval) {
+    return HeapProfiler::start(mean_interval);
+}
+
+void MemoryManager::stopHeapProfiling() {
+    HeapProfiler::stop();
+}
+
+bool MemoryManager::dumpHeapProfile(const char* path) {
+    return HeapProfiler::dumpProfile(path);
+}
@@ -4,18 +4,17 @@
 #include <cstddef>
 #include <cstdlib>
 #include <mutex>
-#include <vector>
-#include <algorithm>
 #include <atomic>
 #include <cassert>
-
-// 核心配置（可根据需求调整）
-const size_t MIN_USER_SIZE = 8;         // 用户可请求的最小大小（字节）
-const size_t MAX_USER_SIZE = 2048;      // 用户可请求的最大池化大小（超过直接malloc）
-const size_t BLOCK_ALIGNMENT = 8;       // 内存对齐步长（必须是2的幂）
-const size_t PAGE_SIZE = 4096;          // 批量分配的页大小（系统页大小通常为4096）
-const size_t MAX_GLOBAL_FREE_MEMORY = 10 * 1024 * 1024; // 全局池最大空闲内存（10MB）
-const size_t RESERVE_BLOCK_COUNT = 4;   // 内存回收时保留的最小块数（每类块）
+#include <pthread.h>
+#include <string>
+#include "MemoryConfig.h"
+#include "SizeClass.h"
+#include "Span.h"
+#include "PageMap.h"
+#include "PageHeap.h"
+#include "PerCpuCache.h"
+#include "HeapProfiler.h"
 
 // 内存统计结构体（支持全局/线程本地统计）
 struct MemoryStats {
@@ -26,14 +25,72 @@ struct MemoryStats {
     size_t total_allocated_memory = 0;  // 累计分配总内存（字节）
 };
 
-// 空闲块链表节点（嵌入块头部，仅空闲时有效）
-struct FreeBlock {
-    size_t size;       // 块总大小（含当前头部）
-    FreeBlock* next;   // 下一个空闲块指针
+// 单写者计数（始终启用）：只有所属线程写入，其他线程可随时读取快照
+// 写入为relaxed的load+store，编译为普通读写指令，不产生加锁的RMW
+class OwnerCount {
+public:
+    void add(size_t n) { value_.store(value_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+    void sub(size_t n) { value_.store(value_.load(std::memory_order_relaxed) - n, std::memory_order_relaxed); }
+    void reset() { value_.store(0, std::memory_order_relaxed); }
+    size_t get() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic_size_t value_{0};
+};
+
+// 单写者统计计数器（线程本地池使用）：EMA_ENABLE_STATS为0时编译为空操作
+#if EMA_ENABLE_STATS
+class StatCounter : public OwnerCount {};
+#else
+class StatCounter {
+public:
+    void add(size_t) {}
+    void sub(size_t) {}
+    void reset() {}
+    size_t get() const { return 0; }
+};
+#endif
+
+// 单个尺寸级别的统计快照（MemoryManager::getSizeClassStats，按需汇总，不阻塞分配路径）
+// 各部分分别读取，并发分配时彼此之间可能有少量偏差
+struct SizeClassStats {
+    size_t block_size = 0;              // 块大小
+    size_t span_pages = 0;              // 每个Span的页数
+    size_t allocate_count = 0;          // 线程本地池累计分配次数（含已退出线程；每CPU缓存模式下不计）
+    size_t deallocate_count = 0;        // 线程本地池累计释放次数
+    size_t central_fetch_count = 0;     // 累计从中心缓存取出的块数
+    size_t central_return_count = 0;    // 累计归还中心缓存的块数
+    size_t spans = 0;                   // 切分给本级别的Span数
+    size_t span_bytes = 0;              // 这些Span的总字节数
+    size_t thread_cache_blocks = 0;     // 各线程本地池中的空闲块
+    size_t per_cpu_blocks = 0;          // 每CPU缓存中的空闲块
+    size_t central_blocks = 0;          // 中心缓存中的空闲块
+    size_t in_use_blocks = 0;           // 在用户手中的块（Span容量减去各级缓存中的空闲块）
+    size_t tail_waste_bytes = 0;        // 内部浪费：各Span末尾不足一块的字节
+    size_t cached_free_bytes = 0;       // 外部碎片：缓存中的空闲块，所在Span仍有块在用，无法交还页堆
+};
+
+// 单个线程本地池的统计快照（MemoryManager::getThreadCacheStats）
+struct ThreadCacheStats {
+    bool active = false;                // 所属线程仍在运行（否则实例等待新线程复用）
+    size_t node = 0;                    // 所属NUMA节点
+    size_t allocate_count = 0;
+    size_t deallocate_count = 0;
+    size_t free_bytes = 0;              // 本地空闲链表的总字节数
+    size_t free_blocks[NUM_SIZE_CLASSES] = {}; // 各级别空闲链表长度
 };
-const size_t FREE_BLOCK_HEADER_SIZE = sizeof(FreeBlock); // 空闲块头部大小
 
-// 基础内存池（线程本地池和全局池的基类）
+// 页面汇总（MemoryManager::getPageSummary）：mapped = resident + released
+struct PageSummary {
+    size_t mapped_bytes = 0;            // 页堆向系统申请的地址空间
+    size_t resident_bytes = 0;          // 其中物理内存仍驻留的部分
+    size_t released_bytes = 0;          // 空闲且已归还系统（madvise）的部分
+    size_t page_heap_free_bytes = 0;    // 页堆中驻留的空闲页
+    size_t small_span_bytes = 0;        // 切分给池化级别的Span
+    size_t large_span_bytes = 0;        // 超大内存（含堆分析抽样）占用的Span
+};
+
+// 基础内存池（按尺寸级别组织的空闲链表集合，线程本地池的存储）
 class BaseMemoryPool {
 public:
     BaseMemoryPool();
@@ -43,117 +100,342 @@ public:
     BaseMemoryPool(const BaseMemoryPool&) = delete;
     BaseMemoryPool& operator=(const BaseMemoryPool&) = delete;
 
-    // 分配内存（user_size：用户实际需要的大小）
+    // 从空闲链表分配内存（user_size：用户实际需要的大小），链表为空时返回nullptr
     void* allocate(size_t user_size);
 
-    // 释放内存（无需传入size，自动从块头部读取）
-    void deallocate(void* user_ptr);
+    // 释放内存（cls：块所属尺寸级别，由调用方经PageMap查得）
+    void deallocate(void* user_ptr, size_t cls);
+
+    // 批量分配：从指定级别链表头部取出至多count个块写入out，返回实际块数（计入分配次数）
+    size_t allocateRange(size_t cls, size_t count, void** out);
+
+    // 批量释放：将count个块串联后一次拼接到指定级别链表头部（计入释放次数）
+    void deallocateRange(size_t cls, void* const* ptrs, size_t count);
+
+    // 将一段已串联的块拼接到指定级别链表头部（O(1)）
+    void pushRange(size_t cls, FreeBlock* head, FreeBlock* tail, size_t count);
 
-    // 将当前池的所有空闲块转移到目标池
-    void transferTo(BaseMemoryPool& dest);
+    // 从指定级别链表头部摘下至多count个块，返回实际块数
+    size_t popRange(size_t cls, size_t count, FreeBlock** head, FreeBlock** tail);
 
-    // 获取内存统计信息
+    // 指定级别链表当前的空闲块数（可由其他线程读取快照）
+    size_t freeCount(size_t cls) const { return free_block_counts_[cls].get(); }
+
+    // 指定级别的累计分配/释放次数（可由其他线程读取）
+    size_t allocateCount(size_t cls) const { return allocate_counts_[cls].get(); }
+    size_t deallocateCount(size_t cls) const { return deallocate_counts_[cls].get(); }
+
+    // 获取内存统计信息（可由其他线程调用）
     MemoryStats getStats() const;
 
-    // 改为public：允许外部管理类触发内存回收（修复访问权限错误）
-    size_t reclaimIdleMemory();
+    // 统计计数清零（仅所属线程调用）
+    void resetStats();
 
 private:
-    // 计算对齐后的块总大小（user_size + 头部大小，按BLOCK_ALIGNMENT对齐）
-    size_t calcAlignedTotalSize(size_t user_size) const;
+    FreeBlock* free_lists_[NUM_SIZE_CLASSES];        // 空闲块链表（索引为尺寸级别）
+    OwnerCount free_block_counts_[NUM_SIZE_CLASSES]; // 每个链表的空闲块数
+
+    // 统计信息（单写者计数器，EMA_ENABLE_STATS为0时编译为空操作）
+    // 次数按级别分别计数；total_allocated_memory_：从中心缓存取得的净内存（取入为正，归还为负）
+    StatCounter allocate_counts_[NUM_SIZE_CLASSES];
+    StatCounter deallocate_counts_[NUM_SIZE_CLASSES];
+    StatCounter total_free_memory_;
+    StatCounter total_allocated_memory_;
+};
+
+// 中心缓存的全局计数（各级别共享，按批更新）
+struct CentralStats {
+    std::atomic_size_t free_bytes{0};       // 中心缓存中的空闲内存
+    std::atomic_size_t allocated_bytes{0};  // 中心缓存持有的Span内存（整Span空闲后归还页堆）
+};
+
+// 中心空闲链表（每个尺寸级别一个实例，各自持有独立的锁）
+// 以Span为单位管理：每个Span记录自己的空闲块与已分出块数，
+// 块全部归还后整个Span交还页堆（由页堆负责合并与归还系统）
+class alignas(64) CentralFreeList {
+public:
+    CentralFreeList() { spanListInit(&nonempty_); }
+    ~CentralFreeList() = default;
+
+    CentralFreeList(const CentralFreeList&) = delete;
+    CentralFreeList& operator=(const CentralFreeList&) = delete;
+
+    // 绑定尺寸级别、共享计数与所属节点的页堆（全局池初始化时调用一次）
+    void init(size_t cls, CentralStats* stats, PageHeap* heap) {
+        cls_ = cls;
+        stats_ = stats;
+        heap_ = heap;
+    }
 
-    // 查找块总大小对应的链表索引（不存在则返回-1）
-    int findBlockSizeIndex(size_t total_size) const;
+    // 取出至多count个块（无空闲块时向页堆申请新Span，新Span归属owner），返回实际块数
+    size_t removeRange(size_t count, ThreadLocalMemoryPool* owner, FreeBlock** head, FreeBlock** tail);
 
-    // 动态添加块大小到列表（线程安全需外部保证）
-    int addBlockSizeIfNotExist(size_t total_size);
+    // 归还一段已串联的块（逐块放回所属Span，Span全部空闲时交还页堆）
+    void insertRange(FreeBlock* head, FreeBlock* tail, size_t count);
 
-    // 批量分配指定大小的块（填充到空闲链表）
-    bool allocateBatch(size_t total_size, int index);
+    // 累加本级别的Span数、空闲块数与进出次数（短暂持锁）
+    void addStats(SizeClassStats& stats);
 
 private:
-    std::vector<size_t> block_sizes_;    // 支持的块总大小列表（有序）
-    std::vector<FreeBlock*> free_lists_; // 空闲块链表（索引对应块大小）
-    std::vector<size_t> free_block_counts_; // 每个链表的空闲块数
+    // 向页堆申请一个Span并切分为块（持锁调用）
+    bool populate(ThreadLocalMemoryPool* owner);
 
-    // 统计信息（原子类型保证线程安全，本地池无锁但统计仍需原子性）
-    std::atomic_size_t allocate_count_{0};
-    std::atomic_size_t deallocate_count_{0};
-    std::atomic_size_t total_free_memory_{0};
-    std::atomic_size_t total_allocated_memory_{0};
+    // 将一个块放回所属Span（持锁调用）
+    void releaseToSpan(FreeBlock* block);
+
+    // 本级别使用的锁（EMA_CENTRAL_SINGLE_LOCK模式下所有级别共用一把锁，用于基准对比）
+    std::mutex& lock();
+
+private:
+    size_t cls_ = 0;
+    CentralStats* stats_ = nullptr;
+    PageHeap* heap_ = nullptr;    // Span的来源与归还去处（同一NUMA节点）
+    std::mutex mutex_;
+    Span nonempty_;               // 仍有空闲块的Span链表（哨兵）
+    size_t count_ = 0;            // 空闲块数
+    size_t span_count_ = 0;       // 切分给本级别且尚未交还页堆的Span数
+    size_t fetch_count_ = 0;      // 累计取出的块数
+    size_t return_count_ = 0;     // 累计归还的块数
 };
 
-// 全局内存池（单例模式，线程安全）
+// 全局内存池（每个NUMA节点一个实例，线程安全）
+// 由每个尺寸级别独立加锁的中心空闲链表组成，不同级别之间互不阻塞；
+// Span来自本节点的页堆，归还的块按所属Span的节点回到原节点的中心缓存，不会交给其他节点的线程
 class GlobalMemoryPool {
 public:
-    static GlobalMemoryPool& getInstance();
+    // 指定NUMA节点的全局池（首次访问时创建，永不析构）
+    static GlobalMemoryPool& getInstance(size_t node = 0);
 
-    // 分配内存（加锁）
+    // 分配单个块（对应级别加锁）
     void* allocate(size_t user_size);
 
-    // 释放内存（加锁）
-    void deallocate(void* user_ptr);
+    // 释放单个块（对应级别加锁）
+    void deallocate(void* user_ptr, size_t cls);
 
-    // 接收其他池的内存转移（加锁，转移后触发内存回收）
+    // 批量取块：至多count个，返回实际块数
+    size_t fetchBatch(size_t cls, size_t count, ThreadLocalMemoryPool* owner,
+                      FreeBlock** head, FreeBlock** tail);
+
+    // 批量还块（块可来自任意节点，按所属Span的节点分别归还；
+    // 完全空闲的Span交还页堆，页堆超出空闲上限的部分归还系统）
+    void returnBatch(size_t cls, FreeBlock* head, FreeBlock* tail, size_t count);
+
+    // 接收其他池的内存转移（逐级别加锁）
     void transferFrom(BaseMemoryPool& src);
 
-    // 获取全局内存统计（加锁）
+    // 获取中心缓存统计（次数为按批进出中心缓存的块数）
     MemoryStats getGlobalStats();
 
+    // 累加指定级别的中心缓存统计
+    void addSizeClassStats(size_t cls, SizeClassStats& stats) { central_lists_[cls].addStats(stats); }
+
     // 禁止拷贝构造和赋值
     GlobalMemoryPool(const GlobalMemoryPool&) = delete;
     GlobalMemoryPool& operator=(const GlobalMemoryPool&) = delete;
 
 private:
-    GlobalMemoryPool() = default;
+    explicit GlobalMemoryPool(size_t node);
     ~GlobalMemoryPool() = default;
 
+    // 将一段块归还中心缓存：单节点时直接归还本实例，多节点时按块所属节点拆分
+    void insertRange(size_t cls, FreeBlock* head, FreeBlock* tail, size_t count);
+
 private:
-    BaseMemoryPool pool_;
-    std::mutex mutex_; // 全局池访问锁
+    CentralFreeList central_lists_[NUM_SIZE_CLASSES];
+    CentralStats stats_;
+
+    // 统计信息（按批更新）
+    std::atomic_size_t allocate_count_{0};
+    std::atomic_size_t deallocate_count_{0};
 };
 
 // 线程本地内存池（每个线程独立实例）
+// 实例由注册表统一创建且永不销毁：线程退出后关闭远程释放队列并放入空闲链表，
+// 供新线程复用，因此其他线程持有的归属指针始终指向有效对象
 class ThreadLocalMemoryPool {
 public:
-    ThreadLocalMemoryPool() = default;
-    ~ThreadLocalMemoryPool();
+    ThreadLocalMemoryPool();
+    ~ThreadLocalMemoryPool() = default;
 
     // 禁止拷贝构造和赋值（避免隐含拷贝BaseMemoryPool）
     ThreadLocalMemoryPool(const ThreadLocalMemoryPool&) = delete;
     ThreadLocalMemoryPool& operator=(const ThreadLocalMemoryPool&) = delete;
 
-    // 分配内存（无锁）
+    // 为当前线程获取一个本地池（优先复用已退出线程留下的实例）
+    static ThreadLocalMemoryPool* acquire();
+
+    // 线程退出时归还本地池：关闭远程释放队列，空闲块全部转移到全局池
+    static void release(ThreadLocalMemoryPool* pool);
+
+    // 分配内存（无锁；本地链表为空时先取回远程释放的块，再从中心缓存批量取块）
     void* allocate(size_t user_size);
 
-    // 释放内存（无锁）
-    void deallocate(void* user_ptr);
+    // 释放内存（无锁；链表超过动态上限时将一半归还中心缓存）
+    void deallocate(void* user_ptr, size_t cls);
+
+    // 批量分配count个同级别块：先取本地链表，不足部分一次性从中心缓存取齐，返回实际块数
+    size_t allocateBatch(size_t cls, size_t count, void** out);
+
+    // 批量释放：整批拼接到本地链表，超过上限的部分一次归还中心缓存
+    void deallocateBatch(size_t cls, void* const* ptrs, size_t count);
+
+    // 将本地缓存的空闲块（含远程释放的块）全部归还中心缓存
+    void flush();
+
+    // 其他线程释放属于本池的块（无锁MPSC入栈），本池已关闭时返回false
+    bool pushRemoteFree(void* user_ptr);
 
     // 获取线程本地内存统计（无锁）
     MemoryStats getLocalStats() const;
 
+    // 本池所属的NUMA节点（获取实例时按当前CPU确定）
+    size_t node() const { return node_; }
+
+    // 汇总所有本地池（含已退出线程累计的计数）的统计；只填充次数与空闲内存
+    static MemoryStats getAllLocalStats();
+
+    // 按级别累加所有本地池的次数（含已退出线程）与空闲链表长度（stats为NUM_SIZE_CLASSES项）
+    static void addSizeClassStats(SizeClassStats* stats);
+
+    // 逐个实例的快照，写入至多max_count项，返回实例总数
+    static size_t getThreadCacheStats(ThreadCacheStats* out, size_t max_count);
+
+private:
+    // 一次性取回其他线程释放的全部块（仅所属线程调用），返回块数
+    size_t drainRemoteFrees();
+
+    // 从中心缓存取一批块（批大小随慢启动上限增长），返回是否取到
+    bool fetchFromCentral(size_t cls);
+
+    // 链表超过上限：一次归还一半到中心缓存，并按慢启动策略调整上限
+    void listTooLong(size_t cls);
+
+    // 链表上限恢复初始值（新建或复用实例时调用）
+    void resetListLengths();
+
+    // 绑定NUMA节点：之后从该节点的全局池取块（新建或复用实例时调用）
+    void bindNode(size_t node);
+
 private:
     BaseMemoryPool pool_;
+    // 慢启动（参考tcmalloc）：级别上限从1开始，每次取块后增长（不足一批时+1，之后+一批），
+    // 直到SizeClass::maxListLength；链表连续超限MAX_LIST_OVERAGES次后收缩一批
+    size_t max_lengths_[NUM_SIZE_CLASSES];
+    size_t length_overages_[NUM_SIZE_CLASSES];
+    std::atomic<FreeBlock*> remote_free_head_{nullptr}; // 远程释放队列（多生产者单消费者）
+    size_t node_ = 0;                                   // 所属NUMA节点
+    GlobalMemoryPool* central_ = nullptr;               // 所属节点的全局池
+    ThreadLocalMemoryPool* next_free_ = nullptr;        // 空闲实例链表（等待复用）
+    ThreadLocalMemoryPool* next_all_ = nullptr;         // 全部实例链表（统计汇总时遍历）
+    bool draining_ = false;                             // 正在取回远程释放的块
+    bool active_ = false;                               // 已分配给线程（注册表锁保护）
 };
 
 // 对外接口类（用户直接调用）
 class MemoryManager {
 private:
-    // 【关键修复】线程本地池：同一个线程共享一个实例
-    static thread_local ThreadLocalMemoryPool local_pool_;
+    // 【关键修复】线程本地池：同一个线程共享一个实例（首次使用时从注册表获取）
+    // initial-exec模型：访问不经过__tls_get_addr（其可能调用malloc，作为malloc替代时会递归）
+    static thread_local ThreadLocalMemoryPool* local_pool_ __attribute__((tls_model("initial-exec")));
+
+    // 获取当前线程的本地池（必要时创建，并注册线程退出回调）
+    static ThreadLocalMemoryPool& localPool();
+
+    // 线程退出回调：归还本地池
+    static void onThreadExit(void* pool);
+
+    // 池化块的缓存层：启用每CPU缓存时优先使用，当前线程不可用时退回线程本地池
+    static void* cacheAllocate(size_t user_size);
+    static void cacheDeallocate(void* user_ptr, size_t cls);
+
+    // 当前线程所在的NUMA节点（每CPU缓存模式下不为线程创建本地池）
+    static size_t currentNode();
+
+    // 堆分析抽中的分配：独占一个页Span并记录调用栈；本次不抽样或页堆无法分配时返回nullptr
+    static void* allocateSampled(size_t user_size);
 
 public:
-    // 分配内存（遵循：本地池→全局池→malloc）
+    // 分配内存（遵循：本地池（未命中时从中心缓存批量补充）→超大内存走页堆→malloc）
     static void* allocate(size_t user_size);
 
-    // 释放内存（池化内存放回本地池，超大内存直接free）
+    // 释放内存（经PageMap判定：未登记的内存直接free，超大内存交还页堆；
+    // 池化内存归还所属线程——本线程直接入本地池，其他线程经其远程释放队列）
     static void deallocate(void* user_ptr);
 
-    // 获取全局内存统计
+    // 按对齐分配（alignment须为2的幂，否则返回nullptr）：
+    // - alignment <= PAGE_SIZE：分配自大小为alignment整数倍的级别，块天然对齐，无逐次填充
+    // - 超大内存或更大的对齐：整页Span，必要时返回Span内部对齐后的地址
+    // 释放使用deallocate(ptr)（不可使用按大小释放：实际级别可能大于申请大小对应的级别）
+    static void* allocateAligned(size_t user_size, size_t alignment);
+
+    // 已知分配大小的释放（user_size须与allocate时一致）：池化内存按大小查表得到级别，
+    // 不查询PageMap，直接放入当前线程的本地池；超大内存仍经PageMap交还页堆
+    static void deallocate(void* user_ptr, size_t user_size);
+
+    // 批量分配count个user_size大小的块写入out，返回实际分配的块数（内存不足时可能少于count）
+    // 池化大小只做一次查表，整段块从本地链表摘下，不足部分一次性从中心缓存补齐
+    static size_t allocateBatch(size_t user_size, size_t count, void** out);
+
+    // 批量释放allocateBatch（或allocate）得到的count个user_size大小的块（user_size须与分配时一致）
+    static void deallocateBatch(void* const* ptrs, size_t count, size_t user_size);
+
+    // 调整已分配内存的大小（语义同realloc：ptr为nullptr时等同allocate，new_size为0时释放并返回nullptr）
+    // - 池化块：新大小仍在原级别可用范围内（且不小于其一半）时返回原指针
+    // - 超大内存：原地收缩，或吸收其后紧邻的空闲页原地扩展
+    // - 其余情况分配新内存、拷贝并释放原内存；失败返回nullptr且原内存保持有效
+    static void* reallocate(void* user_ptr, size_t new_size);
+
+    // 已分配内存的实际可用字节数（不小于申请大小，容器可直接使用多出的部分）
+    static size_t usableSize(void* user_ptr);
+
+    // 获取全局内存统计（按需汇总：所有线程本地池 + 中心缓存 + 页堆）
     static MemoryStats getGlobalStats();
 
+    // 立即归还空闲内存：当前线程的本地缓存（及当前CPU的缓存）交还中心缓存，页堆中全部空闲页归还系统
+    // 返回归还系统的字节数
+    static size_t purge();
+
+    // 空闲页的衰减时间（毫秒，默认DEFAULT_DECAY_MS）：仅后台线程运行时生效；小于0表示只按上限归还
+    static void setDecayTime(long decay_ms);
+
+    // 页堆保留的驻留空闲内存上限（字节，默认MAX_GLOBAL_FREE_MEMORY；多NUMA节点时每个节点的页堆分别计算）
+    static void setRetainedMemoryCap(size_t bytes);
+
+    // 替换页堆的大块内存提供者（如ChunkProvider::createHugePage()），须在首次分配前调用
+    static bool setChunkProvider(ChunkProvider* provider);
+
+    // 启动/停止后台归还线程；运行期间分配/释放路径上不再归还内存
+    static bool startBackgroundPurge();
+    static void stopBackgroundPurge();
+
     // 获取当前线程的本地内存统计
     static MemoryStats getLocalStats();
+
+    // 按尺寸级别的统计（out须有NUM_SIZE_CLASSES项，下标为级别，级别0不使用）
+    // 逐级别短暂持有中心缓存的锁，不阻塞线程本地池，适合周期性采集
+    static void getSizeClassStats(SizeClassStats* out);
+
+    // 每个线程本地池的快照（含等待复用的实例），写入至多max_count项，返回实例总数
+    static size_t getThreadCacheStats(ThreadCacheStats* out, size_t max_count);
+
+    // 页面汇总：向系统申请/驻留/已归还的字节数，及池化与超大内存各自占用的Span
+    static PageSummary getPageSummary();
+
+    // 可读的统计报告：页面汇总、各级别的用量与碎片、各线程本地池
+    static std::string dumpStats();
+
+    // 切换为每CPU缓存模式（基于rseq，缓存内存与CPU数而非线程数成正比；一经启用不再关闭）
+    // 不支持的环境返回false并继续使用线程本地池；已缓存在线程本地池中的块照常使用
+    // 启用后批量接口逐块处理，线程本地统计不再包含池化分配
+    static bool enablePerCpuCache();
+
+    // 抽样堆分析（见HeapProfiler）：平均每分配mean_interval字节抽样一次（0表示HEAP_SAMPLE_INTERVAL）
+    // 只对allocate（含malloc/operator new）抽样；开启过之后按大小释放改经PageMap查询
+    static bool startHeapProfiling(size_t mean_interval = 0);
+    static void stopHeapProfiling();
+
+    // 将存活抽样写为pprof兼容的堆分析文件（pprof --text <程序> <文件>）
+    static bool dumpHeapProfile(const char* path);
 };
 
 void mutex_print(const std::string& msg);
@@ -0,0 +1,72 @@
+#ifndef METADATA_ALLOCATOR_H
+#define METADATA_ALLOCATOR_H
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <sys/mman.h>
+
+// 元数据分配器：为Span等内部元数据提供定长对象
+// - 直接通过mmap向系统申请大块内存，不经过malloc（避免与被管理的内存相互依赖）
+// - 释放的对象进入内部空闲链表复用，大块内存永不归还系统
+template <typename T>
+class MetadataAllocator {
+public:
+    MetadataAllocator() = default;
+    ~MetadataAllocator() = default;
+
+    MetadataAllocator(const MetadataAllocator&) = delete;
+    MetadataAllocator& operator=(const MetadataAllocator&) = delete;
+
+    // 分配并默认构造一个对象（加锁）
+    T* allocate() {
+        void* mem = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (free_list_) {
+                mem = free_list_;
+                free_list_ = free_list_->next;
+            } else {
+                if (free_avail_ < OBJECT_SIZE) {
+                    void* chunk = mmap(nullptr, CHUNK_SIZE, PROT_READ | PROT_WRITE,
+                                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                    if (chunk == MAP_FAILED) return nullptr;
+                    free_area_ = static_cast<char*>(chunk);
+                    free_avail_ = CHUNK_SIZE;
+                }
+                mem = free_area_;
+                free_area_ += OBJECT_SIZE;
+                free_avail_ -= OBJECT_SIZE;
+            }
+        }
+        return new (mem) T();
+    }
+
+    // 析构并回收一个对象（加锁）
+    void deallocate(T* obj) {
+        if (!obj) return;
+        obj->~T();
+        std::lock_guard<std::mutex> lock(mutex_);
+        FreeNode* node = reinterpret_cast<FreeNode*>(obj);
+        node->next = free_list_;
+        free_list_ = node;
+    }
+
+private:
+    struct FreeNode {
+        FreeNode* next;
+    };
+
+    static const size_t OBJECT_ALIGNMENT = alignof(T) > alignof(FreeNode) ? alignof(T) : alignof(FreeNode);
+    static const size_t OBJECT_SIZE =
+        ((sizeof(T) > sizeof(FreeNode) ? sizeof(T) : sizeof(FreeNode)) + OBJECT_ALIGNMENT - 1) &
+        ~(OBJECT_ALIGNMENT - 1);
+    static const size_t CHUNK_SIZE = 64 * 1024; // 每次向系统申请64KB
+
+    std::mutex mutex_;
+    FreeNode* free_list_ = nullptr; // 已回收对象链表
+    char* free_area_ = nullptr;     // 当前大块中未使用区域起点
+    size_t free_avail_ = 0;         // 当前大块剩余字节数
+};
+
+#endif // METADATA_ALLOCATOR_H
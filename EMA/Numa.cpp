@@ -0,0 +1,74 @@
+#include "Numa.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// mbind内存策略（与<linux/mempolicy.h>一致）
+static const int EMA_MPOL_PREFERRED = 1;
+
+// 解析编号列表（如"0"、"0-1"、"0,2-3"），返回最大编号 + 1
+static size_t parseIdList(const char* text) {
+    size_t max_id = 0;
+    size_t value = 0;
+    bool has_value = false;
+    for (const char* p = text;; ++p) {
+        if (*p >= '0' && *p <= '9') {
+            value = value * 10 + static_cast<size_t>(*p - '0');
+            has_value = true;
+            continue;
+        }
+        if (has_value && value + 1 > max_id) max_id = value + 1;
+        value = 0;
+        has_value = false;
+        if (*p == '\0' || *p == '\n') break;
+    }
+    return max_id;
+}
+
+// 读取sysfs中的编号列表文件，返回最大编号 + 1（无法读取时返回0）
+static size_t readIdList(const char* path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+    char buffer[128];
+    ssize_t n;
+    do {
+        n = read(fd, buffer, sizeof(buffer) - 1);
+    } while (n < 0 && errno == EINTR);
+    close(fd);
+    if (n <= 0) return 0;
+    buffer[n] = '\0';
+    return parseIdList(buffer);
+}
+
+static size_t detectNodeCount() {
+    size_t count = readIdList("/sys/devices/system/node/online");
+    if (count == 0) return 1;
+    return count > MAX_NUMA_NODES ? MAX_NUMA_NODES : count;
+}
+
+// -------------------------- Numa 实现 --------------------------
+size_t Numa::nodeCount() {
+    static const size_t count = detectNodeCount();
+    return count;
+}
+
+size_t Numa::cpuCount() {
+    static const size_t count = readIdList("/sys/devices/system/cpu/possible");
+    return count == 0 ? 1 : count;
+}
+
+size_t Numa::currentNode() {
+    if (nodeCount() == 1) return 0;
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) return 0;
+    return node % nodeCount();
+}
+
+bool Numa::bindMemory(void* addr, size_t len, size_t node) {
+    if (nodeCount() == 1) return true;
+    unsigned long mask[MAX_NUMA_NODES / (8 * sizeof(unsigned long)) + 1] = {};
+    mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+    return syscall(SYS_mbind, addr, len, EMA_MPOL_PREFERRED, mask, sizeof(mask) * 8, 0) == 0;
+}
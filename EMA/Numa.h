@@ -0,0 +1,26 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <cstddef>
+#include "MemoryConfig.h"
+
+// CPU/NUMA拓扑查询与内存绑定（直接使用系统调用，不依赖libnuma，且全程不调用malloc）
+// - 节点数来自/sys/devices/system/node/online，超过MAX_NUMA_NODES的节点按取模归并
+// - 单节点（或无法获取拓扑）时所有接口退化为节点0，不产生额外开销
+class Numa {
+public:
+    // 系统NUMA节点数（首次调用时读取并缓存，至少为1）
+    static size_t nodeCount();
+
+    // 系统可能存在的CPU数（/sys/devices/system/cpu/possible，首次调用时读取并缓存，至少为1）
+    static size_t cpuCount();
+
+    // 当前线程所在CPU的NUMA节点（getcpu），单节点时直接返回0
+    static size_t currentNode();
+
+    // 将[addr, addr + len)的物理页优先分配在node上（mbind MPOL_PREFERRED，须在首次访问前调用）
+    // 单节点时不做任何事；失败时返回false，内存仍可正常使用（退回首次访问策略）
+    static bool bindMemory(void* addr, size_t len, size_t node);
+};
+
+#endif // NUMA_H
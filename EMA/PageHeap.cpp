@@ -0,0 +1,384 @@
+#include "PageHeap.h"
+#include "MetadataAllocator.h"
+#include "Numa.h"
+#include "PageMap.h"
+#include <chrono>
+#include <new>
+
+// -------------------------- PageHeap 实现 --------------------------
+// Span元数据分配器（进程内共享，内部加锁）
+static MetadataAllocator<Span>& spanAllocator() {
+    static MetadataAllocator<Span> allocator;
+    return allocator;
+}
+
+// 单调时钟（毫秒）
+static uint64_t nowMs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+PageHeap& PageHeap::getInstance(size_t node) {
+    // 每个节点一个实例，首次访问时创建且永不析构（后台线程与进程退出阶段的释放仍会访问页堆）
+    alignas(PageHeap) static char storage[MAX_NUMA_NODES][sizeof(PageHeap)];
+    static std::atomic<PageHeap*> instances[MAX_NUMA_NODES];
+    static std::mutex init_mutex;
+
+    PageHeap* heap = instances[node].load(std::memory_order_acquire);
+    if (heap) return *heap;
+    std::lock_guard<std::mutex> lock(init_mutex);
+    heap = instances[node].load(std::memory_order_relaxed);
+    if (!heap) {
+        heap = new (storage[node]) PageHeap(node);
+        instances[node].store(heap, std::memory_order_release);
+    }
+    return *heap;
+}
+
+PageHeap::PageHeap(size_t node) : node_(node), provider_(ChunkProvider::createDefault()) {
+    for (size_t i = 0; i < MAX_SMALL_SPAN_PAGES; ++i) {
+        spanListInit(&free_[i].normal);
+        spanListInit(&free_[i].returned);
+    }
+    spanListInit(&large_.normal);
+    spanListInit(&large_.returned);
+}
+
+Span* PageHeap::allocateSpan(size_t num_pages) {
+    if (num_pages == 0) return nullptr;
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    Span* span = searchFreeLists(num_pages);
+    if (!span) {
+        if (!grow(num_pages)) return nullptr;
+        span = searchFreeLists(num_pages);
+        if (!span) return nullptr;
+    }
+    span = carve(span, num_pages);
+
+    // 使用中的Span登记所有页，任意块地址都能查到所属Span
+    if (!PageMap::getInstance().registerSpan(span)) {
+        span->location = Span::ON_NORMAL_FREELIST;
+        mergeIntoFreeList(span);
+        return nullptr;
+    }
+    return span;
+}
+
+void PageHeap::deallocateSpan(Span* span) {
+    if (!span) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    span->size_class = 0;
+    span->objects = nullptr;
+    span->ref_count = 0;
+    span->owner.store(nullptr, std::memory_order_relaxed);
+    span->location = Span::ON_NORMAL_FREELIST;
+    span->free_time = nowMs();
+    mergeIntoFreeList(span);
+
+    // 后台线程运行时由其负责归还，释放路径上不做madvise
+    if (background_.load(std::memory_order_relaxed)) return;
+    size_t cap = retainedCap();
+    if (stats_.free_bytes > cap) releaseLocked(cap);
+}
+
+bool PageHeap::resizeSpan(Span* span, size_t num_pages) {
+    if (!span || num_pages == 0) return false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (num_pages == span->num_pages) return true;
+
+    if (num_pages < span->num_pages) {
+        // 收缩：尾部多余的页拆成空闲Span（可与其后的空闲Span合并）
+        Span* tail = newSpan();
+        if (!tail) return false;
+        tail->start_page = span->start_page + num_pages;
+        tail->num_pages = span->num_pages - num_pages;
+        tail->location = Span::ON_NORMAL_FREELIST;
+        tail->free_time = nowMs();
+        span->num_pages = num_pages;
+        mergeIntoFreeList(tail);
+
+        if (!background_.load(std::memory_order_relaxed)) {
+            size_t cap = retainedCap();
+            if (stats_.free_bytes > cap) releaseLocked(cap);
+        }
+        return true;
+    }
+
+    // 扩展：紧随其后的空闲Span页数足够时，取其前部并入本Span
+    size_t extra = num_pages - span->num_pages;
+    PageMap& page_map = PageMap::getInstance();
+    Span* next = page_map.get(span->start_page + span->num_pages);
+    if (!next || next->location == Span::IN_USE || next->node != span->node || next->num_pages < extra) {
+        return false;
+    }
+
+    removeFromFreeList(next);
+    if (next->num_pages > extra) {
+        Span* rest = newSpan();
+        if (!rest) {
+            prependToFreeList(next);
+            return false;
+        }
+        rest->start_page = next->start_page + extra;
+        rest->num_pages = next->num_pages - extra;
+        rest->location = next->location;
+        rest->free_time = next->free_time;
+        registerFreeSpan(rest);
+        prependToFreeList(rest);
+    }
+    spanAllocator().deallocate(next);
+
+    // 新并入的页登记到本Span（页堆申请chunk时已建好PageMap节点，不会失败）
+    page_map.setRange(span->start_page + span->num_pages, extra, span);
+    span->num_pages = num_pages;
+    return true;
+}
+
+size_t PageHeap::releaseFreePages(size_t keep_bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return releaseLocked(keep_bytes);
+}
+
+bool PageHeap::setChunkProvider(ChunkProvider* provider) {
+    if (!provider) return false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stats_.system_bytes > 0) return false;
+    provider_ = provider;
+    return true;
+}
+
+PageHeapStats PageHeap::getStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+Span* PageHeap::searchFreeLists(size_t num_pages) {
+    // 精确页数链表中找不到时向更大的链表查找（同页数时优先使用驻留内存）
+    for (size_t pages = num_pages; pages < MAX_SMALL_SPAN_PAGES; ++pages) {
+        if (!spanListEmpty(&free_[pages].normal)) return free_[pages].normal.next;
+        if (!spanListEmpty(&free_[pages].returned)) return free_[pages].returned.next;
+    }
+    return searchLargeList(num_pages);
+}
+
+Span* PageHeap::searchLargeList(size_t num_pages) {
+    // best-fit：页数最少者优先，页数相同取地址较低者（减少碎片）
+    Span* best = nullptr;
+    Span* lists[] = {&large_.normal, &large_.returned};
+    for (Span* list : lists) {
+        for (Span* span = list->next; span != list; span = span->next) {
+            if (span->num_pages < num_pages) continue;
+            if (!best || span->num_pages < best->num_pages ||
+                (span->num_pages == best->num_pages && span->start_page < best->start_page)) {
+                best = span;
+            }
+        }
+    }
+    return best;
+}
+
+Span* PageHeap::carve(Span* span, size_t num_pages) {
+    removeFromFreeList(span);
+
+    // 多余的页拆成新的空闲Span（保留原位置：驻留或已归还）
+    size_t extra = span->num_pages - num_pages;
+    if (extra > 0) {
+        Span* leftover = newSpan();
+        if (leftover) {
+            leftover->start_page = span->start_page + num_pages;
+            leftover->num_pages = extra;
+            leftover->location = span->location;
+            leftover->free_time = span->free_time;
+            span->num_pages = num_pages;
+            registerFreeSpan(leftover);
+            prependToFreeList(leftover);
+        }
+    }
+    span->location = Span::IN_USE;
+    return span;
+}
+
+Span* PageHeap::newSpan() {
+    Span* span = spanAllocator().allocate();
+    if (span) span->node = static_cast<uint8_t>(node_);
+    return span;
+}
+
+void PageHeap::mergeIntoFreeList(Span* span) {
+    // 只合并位置相同的邻居（驻留与驻留、已归还与已归还），保证归还统计准确；
+    // 相邻的chunk可能属于其他节点的页堆，不能跨页堆合并
+    PageMap& page_map = PageMap::getInstance();
+    auto mergeable = [span](const Span* neighbor) {
+        return neighbor && neighbor->location == span->location && neighbor->node == span->node;
+    };
+
+    Span* prev = span->start_page > 0 ? page_map.get(span->start_page - 1) : nullptr;
+    if (mergeable(prev)) {
+        removeFromFreeList(prev);
+        span->start_page = prev->start_page;
+        span->num_pages += prev->num_pages;
+        spanAllocator().deallocate(prev);
+    }
+
+    Span* next = page_map.get(span->start_page + span->num_pages);
+    if (mergeable(next)) {
+        removeFromFreeList(next);
+        span->num_pages += next->num_pages;
+        spanAllocator().deallocate(next);
+    }
+
+    registerFreeSpan(span);
+    prependToFreeList(span);
+}
+
+void PageHeap::prependToFreeList(Span* span) {
+    SpanLists& lists = listsFor(span->num_pages);
+    if (span->location == Span::ON_RETURNED_FREELIST) {
+        spanListPrepend(&lists.returned, span);
+        stats_.released_bytes += span->bytes();
+    } else {
+        spanListPrepend(&lists.normal, span);
+        stats_.free_bytes += span->bytes();
+    }
+}
+
+void PageHeap::removeFromFreeList(Span* span) {
+    spanListRemove(span);
+    if (span->location == Span::ON_RETURNED_FREELIST) {
+        stats_.released_bytes -= span->bytes();
+    } else {
+        stats_.free_bytes -= span->bytes();
+    }
+}
+
+bool PageHeap::registerFreeSpan(Span* span) {
+    // 空闲Span只需登记首/尾页（供相邻Span合并时查询），中间页不再访问
+    PageMap& page_map = PageMap::getInstance();
+    return page_map.setRange(span->start_page, 1, span) &&
+           page_map.setRange(span->start_page + span->num_pages - 1, 1, span);
+}
+
+bool PageHeap::grow(size_t num_pages) {
+    size_t bytes = 0;
+    void* mem = provider_->allocateChunk(num_pages << PAGE_SHIFT, &bytes);
+    if (!mem) return false;
+    size_t pages = bytes >> PAGE_SHIFT;
+
+    // 多节点时在首次访问前把物理页绑定到本节点（失败时退回首次访问策略）
+    Numa::bindMemory(mem, bytes, node_);
+
+    // chunk不归还系统，元数据或PageMap节点申请失败时只归还其物理内存
+    Span* span = newSpan();
+    if (!span) {
+        provider_->releasePages(mem, bytes);
+        return false;
+    }
+    span->start_page = reinterpret_cast<uintptr_t>(mem) >> PAGE_SHIFT;
+    span->num_pages = pages;
+    span->location = Span::ON_NORMAL_FREELIST;
+    span->free_time = nowMs();
+
+    // 预先建好所有页的PageMap节点，之后登记使用中的Span不会因缺节点失败
+    if (!PageMap::getInstance().setRange(span->start_page, pages, span)) {
+        PageMap::getInstance().setRange(span->start_page, pages, nullptr);
+        spanAllocator().deallocate(span);
+        provider_->releasePages(mem, bytes);
+        return false;
+    }
+    stats_.system_bytes += bytes;
+    mergeIntoFreeList(span);
+    return true;
+}
+
+size_t PageHeap::releaseLocked(size_t keep_bytes) {
+    size_t released = 0;
+    while (stats_.free_bytes > keep_bytes) {
+        // 优先归还大块，同一链表中取最久未使用的（链表尾部）
+        Span* span = nullptr;
+        if (!spanListEmpty(&large_.normal)) {
+            span = large_.normal.prev;
+        } else {
+            for (size_t pages = MAX_SMALL_SPAN_PAGES - 1; pages > 0 && !span; --pages) {
+                if (!spanListEmpty(&free_[pages].normal)) span = free_[pages].normal.prev;
+            }
+        }
+        if (!span) break;
+        released += span->bytes();
+        releaseSpan(span);
+    }
+    return released;
+}
+
+size_t PageHeap::releaseExpiredLocked(uint64_t cutoff) {
+    // 链表按进入时间从新到旧排列，从尾部归还直到遇到未过期的Span
+    size_t released = 0;
+    for (size_t pages = 1; pages <= MAX_SMALL_SPAN_PAGES; ++pages) {
+        Span* list = pages < MAX_SMALL_SPAN_PAGES ? &free_[pages].normal : &large_.normal;
+        while (!spanListEmpty(list) && list->prev->free_time <= cutoff) {
+            Span* span = list->prev;
+            released += span->bytes();
+            releaseSpan(span);
+        }
+    }
+    return released;
+}
+
+void PageHeap::releaseSpan(Span* span) {
+    removeFromFreeList(span);
+    provider_->releasePages(span->startAddress(), span->bytes());
+    span->location = Span::ON_RETURNED_FREELIST;
+    mergeIntoFreeList(span);
+}
+
+bool PageHeap::startBackgroundPurge() {
+    std::lock_guard<std::mutex> lock(purge_mutex_);
+    if (purge_thread_.joinable()) return true;
+    purge_stop_ = false;
+    try {
+        purge_thread_ = std::thread(&PageHeap::backgroundPurgeLoop, this);
+    } catch (const std::system_error&) {
+        return false;
+    }
+    background_.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+void PageHeap::stopBackgroundPurge() {
+    std::thread thread;
+    {
+        std::lock_guard<std::mutex> lock(purge_mutex_);
+        if (!purge_thread_.joinable()) return;
+        purge_stop_ = true;
+        background_.store(false, std::memory_order_relaxed);
+        thread = std::move(purge_thread_);
+    }
+    purge_cv_.notify_all();
+    thread.join();
+}
+
+void PageHeap::backgroundPurgeLoop() {
+    std::unique_lock<std::mutex> purge_lock(purge_mutex_);
+    while (!purge_stop_) {
+        // 唤醒间隔取衰减时间的1/8，限制在[MIN_PURGE_INTERVAL_MS, MAX_PURGE_INTERVAL_MS]
+        long decay_ms = decayTime();
+        long interval = decay_ms / 8;
+        if (interval < MIN_PURGE_INTERVAL_MS) interval = MIN_PURGE_INTERVAL_MS;
+        if (interval > MAX_PURGE_INTERVAL_MS) interval = MAX_PURGE_INTERVAL_MS;
+        purge_cv_.wait_for(purge_lock, std::chrono::milliseconds(interval));
+        if (purge_stop_) break;
+
+        purge_lock.unlock();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (decay_ms >= 0) {
+                uint64_t now = nowMs();
+                uint64_t decay = static_cast<uint64_t>(decay_ms);
+                releaseExpiredLocked(now > decay ? now - decay : 0);
+            }
+            releaseLocked(retainedCap());
+        }
+        purge_lock.lock();
+    }
+}
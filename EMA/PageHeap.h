@@ -0,0 +1,127 @@
+#ifndef PAGE_HEAP_H
+#define PAGE_HEAP_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include "ChunkProvider.h"
+#include "MemoryConfig.h"
+#include "Span.h"
+
+// 页堆统计信息
+struct PageHeapStats {
+    size_t system_bytes = 0;    // 向系统申请的地址空间（mmap）
+    size_t free_bytes = 0;      // 空闲且物理内存仍驻留
+    size_t released_bytes = 0;  // 空闲且物理内存已归还系统（madvise）
+};
+
+// 页堆：以页为单位管理向系统申请的内存（参考tcmalloc PageHeap）
+// - 内存以CHUNK_SIZE为粒度从可替换的ChunkProvider申请（默认匿名mmap，可选透明大页/hugetlbfs）
+// - 空闲Span按页数挂链：1~MAX_SMALL_SPAN_PAGES-1页精确分链，更大的进入大块链表（best-fit）
+// - 归还的Span经PageMap查询首/尾页，与前后相邻的空闲Span合并
+// - 空闲Span经ChunkProvider::releasePages（默认madvise(MADV_DONTNEED)）归还物理内存；地址空间保留，再次分配时由内核按需提供清零页
+// - 归还时机（类似jemalloc的dirty decay）：
+//     未启动后台线程：释放Span时若驻留空闲内存超过上限，立即归还最久未用的部分
+//     启动后台线程后：分配/释放路径不再归还；后台线程周期性归还空闲超过衰减时间的Span，
+//                    并把驻留空闲内存压到上限以内
+// - 所有操作由一把锁保护（仅在中心缓存缺页或整个Span空闲时调用）
+// - 每个NUMA节点一个实例：chunk经Numa::bindMemory绑定到本节点，Span记录所属节点，
+//   归还时回到原节点的页堆；归还策略参数与后台线程按实例设置（由MemoryManager统一下发）
+class PageHeap {
+public:
+    // 指定NUMA节点的页堆（首次访问时创建，永不析构）
+    static PageHeap& getInstance(size_t node = 0);
+
+    // Span所属的页堆
+    static PageHeap& forSpan(const Span* span) { return getInstance(span->node); }
+
+    // 分配num_pages页的Span（所有页登记到PageMap），失败返回nullptr
+    Span* allocateSpan(size_t num_pages);
+
+    // 归还Span（与相邻空闲Span合并，驻留空闲内存超限时归还系统）
+    void deallocateSpan(Span* span);
+
+    // 原地调整使用中Span的页数：收缩时尾部页归还空闲链表；扩展时吸收紧随其后的空闲Span，
+    // 后方没有足够的空闲页时返回false（Span保持不变）
+    bool resizeSpan(Span* span, size_t num_pages);
+
+    // 将驻留的空闲内存归还系统，直到不超过keep_bytes，返回归还的字节数
+    size_t releaseFreePages(size_t keep_bytes);
+
+    // 衰减时间（毫秒）：空闲超过该时长的Span由后台线程归还；小于0表示只按上限归还
+    void setDecayTime(long decay_ms) { decay_ms_.store(decay_ms, std::memory_order_relaxed); }
+    long decayTime() const { return decay_ms_.load(std::memory_order_relaxed); }
+
+    // 驻留空闲内存上限（字节）
+    void setRetainedCap(size_t bytes) { retained_cap_.store(bytes, std::memory_order_relaxed); }
+    size_t retainedCap() const { return retained_cap_.load(std::memory_order_relaxed); }
+
+    // 启动/停止后台归还线程（重复启动返回true且不创建新线程）
+    bool startBackgroundPurge();
+    void stopBackgroundPurge();
+
+    // 替换大块内存提供者（须在首次分配前调用，页堆已申请过内存时返回false）
+    bool setChunkProvider(ChunkProvider* provider);
+
+    // 获取页堆统计信息
+    PageHeapStats getStats();
+
+    PageHeap(const PageHeap&) = delete;
+    PageHeap& operator=(const PageHeap&) = delete;
+
+private:
+    explicit PageHeap(size_t node);
+    ~PageHeap() = default;
+
+    // 同一页数的两条空闲链表（驻留 / 已归还）
+    struct SpanLists {
+        Span normal;
+        Span returned;
+    };
+
+    // 以下函数均需持锁调用
+    Span* newSpan();
+    Span* searchFreeLists(size_t num_pages);
+    Span* searchLargeList(size_t num_pages);
+    Span* carve(Span* span, size_t num_pages);
+    void mergeIntoFreeList(Span* span);
+    void prependToFreeList(Span* span);
+    void removeFromFreeList(Span* span);
+    bool registerFreeSpan(Span* span);
+    bool grow(size_t num_pages);
+    size_t releaseLocked(size_t keep_bytes);
+    size_t releaseExpiredLocked(uint64_t cutoff);
+    void releaseSpan(Span* span);
+
+    // 后台线程主循环
+    void backgroundPurgeLoop();
+
+    SpanLists& listsFor(size_t num_pages) {
+        return num_pages < MAX_SMALL_SPAN_PAGES ? free_[num_pages] : large_;
+    }
+
+private:
+    size_t node_;
+    std::mutex mutex_;
+    SpanLists free_[MAX_SMALL_SPAN_PAGES]; // 下标为页数（0不使用）
+    SpanLists large_;                      // 页数 >= MAX_SMALL_SPAN_PAGES
+    PageHeapStats stats_;
+    ChunkProvider* provider_;
+
+    // 归还策略参数
+    std::atomic_long decay_ms_{DEFAULT_DECAY_MS};
+    std::atomic_size_t retained_cap_{MAX_GLOBAL_FREE_MEMORY};
+
+    // 后台归还线程
+    std::atomic_bool background_{false};
+    std::mutex purge_mutex_;
+    std::condition_variable purge_cv_;
+    bool purge_stop_ = false;
+    std::thread purge_thread_;
+};
+
+#endif // PAGE_HEAP_H
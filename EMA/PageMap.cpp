@@ -0,0 +1,66 @@
+#include "PageMap.h"
+#include <sys/mman.h>
+
+// -------------------------- PageMap 实现 --------------------------
+PageMap& PageMap::getInstance() {
+    static PageMap instance; // C++11线程安全单例（析构为平凡析构，进程退出时不会被销毁）
+    return instance;
+}
+
+void* PageMap::allocateNode(size_t bytes) {
+    // mmap得到的匿名内存已清零，原子指针全部为nullptr
+    void* mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return mem == MAP_FAILED ? nullptr : mem;
+}
+
+void PageMap::freeNode(void* node, size_t bytes) {
+    munmap(node, bytes);
+}
+
+PageMap::Leaf* PageMap::ensureLeaf(uintptr_t page_id) {
+    if (page_id >> PAGE_ID_BITS) return nullptr;
+
+    // 第一级：根 -> 中间节点（CAS安装，竞争失败则释放自己创建的节点）
+    std::atomic<Node*>& root_slot = root_[page_id >> (MID_BITS + LEAF_BITS)];
+    Node* node = root_slot.load(std::memory_order_acquire);
+    if (!node) {
+        Node* created = static_cast<Node*>(allocateNode(sizeof(Node)));
+        if (!created) return nullptr;
+        if (root_slot.compare_exchange_strong(node, created, std::memory_order_acq_rel)) {
+            node = created;
+        } else {
+            freeNode(created, sizeof(Node));
+        }
+    }
+
+    // 第二级：中间节点 -> 叶子节点
+    std::atomic<Leaf*>& mid_slot = node->leaves[(page_id >> LEAF_BITS) & (MID_LENGTH - 1)];
+    Leaf* leaf = mid_slot.load(std::memory_order_acquire);
+    if (!leaf) {
+        Leaf* created = static_cast<Leaf*>(allocateNode(sizeof(Leaf)));
+        if (!created) return nullptr;
+        if (mid_slot.compare_exchange_strong(leaf, created, std::memory_order_acq_rel)) {
+            leaf = created;
+        } else {
+            freeNode(created, sizeof(Leaf));
+        }
+    }
+    return leaf;
+}
+
+bool PageMap::setRange(uintptr_t start_page, size_t num_pages, Span* span) {
+    for (size_t i = 0; i < num_pages; ++i) {
+        uintptr_t page_id = start_page + i;
+        Leaf* leaf = span ? ensureLeaf(page_id) : nullptr;
+        if (!span) {
+            // 注销时节点必然已存在，直接定位
+            Node* node = root_[page_id >> (MID_BITS + LEAF_BITS)].load(std::memory_order_acquire);
+            if (!node) continue;
+            leaf = node->leaves[(page_id >> LEAF_BITS) & (MID_LENGTH - 1)].load(std::memory_order_acquire);
+            if (!leaf) continue;
+        }
+        if (!leaf) return false;
+        leaf->spans[page_id & (LEAF_LENGTH - 1)].store(span, std::memory_order_release);
+    }
+    return true;
+}
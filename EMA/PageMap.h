@@ -0,0 +1,76 @@
+#ifndef PAGE_MAP_H
+#define PAGE_MAP_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "MemoryConfig.h"
+#include "Span.h"
+
+// 页映射表（三级基数树）：页号 -> 所属Span
+// - 覆盖48位虚拟地址空间（页号36位，按12/12/12拆分为三级）
+// - 中间节点按需通过mmap创建且永不释放，因此查询无需加锁
+// - 未登记的页返回nullptr（例如超大内存走malloc得到的指针）
+class PageMap {
+public:
+    static PageMap& getInstance();
+
+    // 查询页号对应的Span（无锁）
+    Span* get(uintptr_t page_id) const {
+        if (page_id >> PAGE_ID_BITS) return nullptr;
+        Node* node = root_[page_id >> (MID_BITS + LEAF_BITS)].load(std::memory_order_acquire);
+        if (!node) return nullptr;
+        Leaf* leaf = node->leaves[(page_id >> LEAF_BITS) & (MID_LENGTH - 1)].load(std::memory_order_acquire);
+        if (!leaf) return nullptr;
+        return leaf->spans[page_id & (LEAF_LENGTH - 1)].load(std::memory_order_acquire);
+    }
+
+    // 查询任意地址所属的Span（无锁）
+    Span* lookup(const void* ptr) const {
+        return get(reinterpret_cast<uintptr_t>(ptr) >> PAGE_SHIFT);
+    }
+
+    // 登记[start_page, start_page + num_pages)的所有页，span为nullptr表示注销
+    bool setRange(uintptr_t start_page, size_t num_pages, Span* span);
+
+    // 登记Span覆盖的所有页
+    bool registerSpan(Span* span) { return setRange(span->start_page, span->num_pages, span); }
+
+    // 注销Span覆盖的所有页
+    void unregisterSpan(Span* span) { setRange(span->start_page, span->num_pages, nullptr); }
+
+    PageMap(const PageMap&) = delete;
+    PageMap& operator=(const PageMap&) = delete;
+
+private:
+    PageMap() = default;
+    ~PageMap() = default;
+
+    static const size_t ADDRESS_BITS = 48;
+    static const size_t PAGE_ID_BITS = ADDRESS_BITS - PAGE_SHIFT;
+    static const size_t LEAF_BITS = PAGE_ID_BITS / 3;
+    static const size_t MID_BITS = PAGE_ID_BITS / 3;
+    static const size_t ROOT_BITS = PAGE_ID_BITS - LEAF_BITS - MID_BITS;
+    static const size_t LEAF_LENGTH = static_cast<size_t>(1) << LEAF_BITS;
+    static const size_t MID_LENGTH = static_cast<size_t>(1) << MID_BITS;
+    static const size_t ROOT_LENGTH = static_cast<size_t>(1) << ROOT_BITS;
+
+    struct Leaf {
+        std::atomic<Span*> spans[LEAF_LENGTH];
+    };
+    struct Node {
+        std::atomic<Leaf*> leaves[MID_LENGTH];
+    };
+
+    // 确保页号所在的叶子节点存在（不存在则创建）
+    Leaf* ensureLeaf(uintptr_t page_id);
+
+    // 向系统申请已清零的节点内存
+    static void* allocateNode(size_t bytes);
+    static void freeNode(void* node, size_t bytes);
+
+private:
+    std::atomic<Node*> root_[ROOT_LENGTH] = {};
+};
+
+#endif // PAGE_MAP_H
@@ -0,0 +1,297 @@
+#include "PerCpuCache.h"
+#include "MemoryManager.h"
+#include "Numa.h"
+#include <mutex>
+#include <sys/mman.h>
+
+#if defined(__x86_64__) && defined(__has_include)
+#if __has_include(<sys/rseq.h>)
+#include <sys/rseq.h>
+#define EMA_HAVE_RSEQ 1
+#endif
+#endif
+
+// 链表字：低48位为链表头指针（x86_64用户态地址不超过47位），高16位为块数
+const int LIST_COUNT_SHIFT = 48;
+const size_t MAX_LIST_COUNT = 0xffff;
+
+std::atomic_bool PerCpuCache::enabled_{false};
+char* PerCpuCache::slabs_ = nullptr;
+size_t PerCpuCache::cpu_stride_ = 0;
+size_t PerCpuCache::num_cpus_ = 0;
+size_t PerCpuCache::limits_[NUM_SIZE_CLASSES];
+
+#ifdef EMA_HAVE_RSEQ
+static_assert(offsetof(struct rseq, cpu_id) == 4 && offsetof(struct rseq, rseq_cs) == 8,
+              "rseq ABI layout");
+
+// 当前线程的rseq区域（glibc注册，位于线程指针偏移__rseq_offset处）
+static inline volatile struct rseq* currentRseq() {
+    return reinterpret_cast<volatile struct rseq*>(
+        static_cast<char*>(__builtin_thread_pointer()) + __rseq_offset);
+}
+
+// rseq临界区的公共部分：
+//   3: struct rseq_cs描述符（记录临界区[1, 2)与中止入口4）
+//   6: 登记描述符后进入临界区；被抢占、迁移或收到信号时内核跳转到4，4再跳回6重试
+//   中止入口前4字节须为RSEQ_SIG（内核校验）
+#define EMA_RSEQ_CS_BEGIN                                                   \
+    ".pushsection __rseq_cs, \"aw\"\n\t"                                    \
+    ".balign 32\n\t"                                                        \
+    "3:\n\t"                                                                \
+    ".long 0x0, 0x0\n\t"                                                    \
+    ".quad 1f, (2f - 1f), 4f\n\t"                                           \
+    ".popsection\n\t"                                                       \
+    "6:\n\t"                                                                \
+    "leaq 3b(%%rip), %[tmp]\n\t"                                            \
+    "movq %[tmp], 8(%[rs])\n\t"                                             \
+    "1:\n\t"                                                                \
+    "movl 4(%[rs]), %k[tmp]\n\t"                                            \
+    "imulq %[stride], %[tmp]\n\t"                                           \
+    "addq %[list], %[tmp]\n\t"
+
+#define EMA_RSEQ_CS_ABORT                                                   \
+    ".pushsection __rseq_failure, \"ax\"\n\t"                               \
+    ".byte 0x0f, 0xb9, 0x3d\n\t"                                            \
+    ".long 0x53053053\n\t"                                                  \
+    "4:\n\t"                                                                \
+    "jmp 6b\n\t"                                                            \
+    ".popsection\n\t"
+
+// 从当前CPU的链表弹出一块，链表为空时返回nullptr
+// list为CPU 0上该级别链表字的地址，各CPU的链表字相隔stride字节
+static inline void* rseqPop(volatile struct rseq* rs, char* list, size_t stride) {
+    uintptr_t result;
+    uintptr_t tmp;
+    uintptr_t head;
+    __asm__ __volatile__(
+        EMA_RSEQ_CS_BEGIN
+        "movq (%[tmp]), %[result]\n\t"       // 链表字
+        "movq %[result], %[head]\n\t"
+        "shlq $16, %[head]\n\t"
+        "shrq $16, %[head]\n\t"              // 链表头
+        "testq %[head], %[head]\n\t"
+        "jz 5f\n\t"
+        "shrq $48, %[result]\n\t"
+        "decq %[result]\n\t"
+        "shlq $48, %[result]\n\t"
+        "addq (%[head]), %[result]\n\t"      // 块数-1 | head->next
+        "movq %[result], (%[tmp])\n\t"       // 提交
+        "2:\n\t"
+        "movq %[head], %[result]\n\t"
+        "jmp 7f\n\t"
+        "5:\n\t"
+        "xorl %k[result], %k[result]\n\t"
+        "7:\n\t"
+        EMA_RSEQ_CS_ABORT
+        : [result] "=&r"(result), [tmp] "=&r"(tmp), [head] "=&r"(head)
+        : [rs] "r"(rs), [list] "r"(list), [stride] "r"(stride)
+        : "memory", "cc");
+    return reinterpret_cast<void*>(result);
+}
+
+// 将一块压入当前CPU的链表，块数已达limit时返回false（此时block->next可能已被改写）
+static inline bool rseqPush(volatile struct rseq* rs, char* list, size_t stride, void* block, size_t limit) {
+    uintptr_t result;
+    uintptr_t tmp;
+    uintptr_t head;
+    __asm__ __volatile__(
+        EMA_RSEQ_CS_BEGIN
+        "movq (%[tmp]), %[head]\n\t"         // 链表字
+        "movq %[head], %[result]\n\t"
+        "shrq $48, %[result]\n\t"            // 块数
+        "cmpq %[limit], %[result]\n\t"
+        "jae 5f\n\t"
+        "incq %[result]\n\t"
+        "shlq $48, %[result]\n\t"
+        "shlq $16, %[head]\n\t"
+        "shrq $16, %[head]\n\t"              // 链表头
+        "movq %[head], (%[block])\n\t"       // block->next = head
+        "orq %[block], %[result]\n\t"
+        "movq %[result], (%[tmp])\n\t"       // 提交
+        "2:\n\t"
+        "movl $1, %k[result]\n\t"
+        "jmp 7f\n\t"
+        "5:\n\t"
+        "xorl %k[result], %k[result]\n\t"
+        "7:\n\t"
+        EMA_RSEQ_CS_ABORT
+        : [result] "=&r"(result), [tmp] "=&r"(tmp), [head] "=&r"(head)
+        : [rs] "r"(rs), [list] "r"(list), [stride] "r"(stride), [block] "r"(block), [limit] "r"(limit)
+        : "memory", "cc");
+    return result != 0;
+}
+
+// 当前线程是否已注册rseq（cpu_id为负表示未注册或注册失败）
+static inline bool rseqReady(volatile struct rseq* rs) {
+    return static_cast<int32_t>(rs->cpu_id) >= 0;
+}
+#endif // EMA_HAVE_RSEQ
+
+// -------------------------- PerCpuCache 实现 --------------------------
+bool PerCpuCache::supported() {
+#ifdef EMA_HAVE_RSEQ
+    return __rseq_size > 0 && rseqReady(currentRseq());
+#else
+    return false;
+#endif
+}
+
+bool PerCpuCache::enable() {
+    static std::mutex enable_mutex;
+    std::lock_guard<std::mutex> lock(enable_mutex);
+    if (enabled()) return true;
+    if (!supported()) return false;
+
+    // 每CPU一段链表字，按缓存行取整避免不同CPU间的伪共享；页按需分配，未使用的CPU不占物理内存
+    size_t cpus = Numa::cpuCount();
+    size_t stride = (NUM_SIZE_CLASSES * sizeof(uint64_t) + 63) & ~static_cast<size_t>(63);
+    void* mem = mmap(nullptr, cpus * stride, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) return false;
+
+    // 每级别上限：约PER_CPU_CLASS_MAX_BYTES，不少于一批，不超过线程本地链表的上限
+    for (size_t cls = 1; cls < NUM_SIZE_CLASSES; ++cls) {
+        size_t limit = PER_CPU_CLASS_MAX_BYTES / SizeClass::classToSize(cls);
+        if (limit < SizeClass::numToMove(cls)) limit = SizeClass::numToMove(cls);
+        if (limit > SizeClass::maxListLength(cls)) limit = SizeClass::maxListLength(cls);
+        limits_[cls] = limit > MAX_LIST_COUNT ? MAX_LIST_COUNT : limit;
+    }
+    slabs_ = static_cast<char*>(mem);
+    cpu_stride_ = stride;
+    num_cpus_ = cpus;
+    enabled_.store(true, std::memory_order_release);
+    return true;
+}
+
+void* PerCpuCache::allocate(size_t cls) {
+#ifdef EMA_HAVE_RSEQ
+    volatile struct rseq* rs = currentRseq();
+    if (!rseqReady(rs)) return nullptr;
+    void* p = rseqPop(rs, slabs_ + cls * sizeof(uint64_t), cpu_stride_);
+    if (p) return p;
+    return refill(cls);
+#else
+    (void)cls;
+    return nullptr;
+#endif
+}
+
+bool PerCpuCache::deallocate(void* ptr, size_t cls) {
+#ifdef EMA_HAVE_RSEQ
+    volatile struct rseq* rs = currentRseq();
+    if (!rseqReady(rs)) return false;
+    if (!rseqPush(rs, slabs_ + cls * sizeof(uint64_t), cpu_stride_, ptr, limits_[cls])) overflow(ptr, cls);
+    return true;
+#else
+    (void)ptr;
+    (void)cls;
+    return false;
+#endif
+}
+
+void* PerCpuCache::refill(size_t cls) {
+#ifdef EMA_HAVE_RSEQ
+    size_t want = SizeClass::numToMove(cls);
+    if (want > limits_[cls]) want = limits_[cls];
+
+    // 每CPU缓存的Span不归属任何线程，其他线程释放的块直接进入释放者所在CPU
+    FreeBlock* head = nullptr;
+    FreeBlock* tail = nullptr;
+    GlobalMemoryPool& central = GlobalMemoryPool::getInstance(Numa::currentNode());
+    size_t count = central.fetchBatch(cls, want, nullptr, &head, &tail);
+    if (count == 0) return nullptr;
+
+    // 第一块直接返回，其余压入当前CPU；期间迁移到已满的CPU时剩余部分退回中心缓存
+    void* result = head;
+    head = head->next;
+    count--;
+    volatile struct rseq* rs = currentRseq();
+    char* list = slabs_ + cls * sizeof(uint64_t);
+    while (head) {
+        FreeBlock* next = head->next;
+        if (!rseqPush(rs, list, cpu_stride_, head, limits_[cls])) {
+            head->next = next;
+            central.returnBatch(cls, head, tail, count);
+            break;
+        }
+        head = next;
+        count--;
+    }
+    return result;
+#else
+    (void)cls;
+    return nullptr;
+#endif
+}
+
+void PerCpuCache::overflow(void* ptr, size_t cls) {
+#ifdef EMA_HAVE_RSEQ
+    // 从当前CPU弹出一半，与ptr串成一段一次归还中心缓存
+    volatile struct rseq* rs = currentRseq();
+    char* list = slabs_ + cls * sizeof(uint64_t);
+    FreeBlock* head = static_cast<FreeBlock*>(ptr);
+    FreeBlock* tail = head;
+    head->next = nullptr;
+    size_t count = 1;
+    for (size_t i = limits_[cls] / 2; i > 0; --i) {
+        FreeBlock* block = static_cast<FreeBlock*>(rseqPop(rs, list, cpu_stride_));
+        if (!block) break;
+        block->next = head;
+        head = block;
+        count++;
+    }
+    GlobalMemoryPool::getInstance(Numa::currentNode()).returnBatch(cls, head, tail, count);
+#else
+    (void)ptr;
+    (void)cls;
+#endif
+}
+
+size_t PerCpuCache::drainCurrentCpu() {
+    if (!enabled()) return 0;
+#ifdef EMA_HAVE_RSEQ
+    volatile struct rseq* rs = currentRseq();
+    if (!rseqReady(rs)) return 0;
+    size_t bytes = 0;
+    for (size_t cls = 1; cls < NUM_SIZE_CLASSES; ++cls) {
+        char* list = slabs_ + cls * sizeof(uint64_t);
+        FreeBlock* head = nullptr;
+        FreeBlock* tail = nullptr;
+        size_t count = 0;
+        while (FreeBlock* block = static_cast<FreeBlock*>(rseqPop(rs, list, cpu_stride_))) {
+            block->next = head;
+            if (!tail) tail = block;
+            head = block;
+            count++;
+        }
+        if (count == 0) continue;
+        GlobalMemoryPool::getInstance(Numa::currentNode()).returnBatch(cls, head, tail, count);
+        bytes += count * SizeClass::classToSize(cls);
+    }
+    return bytes;
+#else
+    return 0;
+#endif
+}
+
+size_t PerCpuCache::freeBytes() {
+    if (!enabled()) return 0;
+    size_t bytes = 0;
+    for (size_t cpu = 0; cpu < num_cpus_; ++cpu) {
+        const volatile uint64_t* words = reinterpret_cast<const volatile uint64_t*>(slabs_ + cpu * cpu_stride_);
+        for (size_t cls = 1; cls < NUM_SIZE_CLASSES; ++cls) {
+            bytes += static_cast<size_t>(words[cls] >> LIST_COUNT_SHIFT) * SizeClass::classToSize(cls);
+        }
+    }
+    return bytes;
+}
+
+size_t PerCpuCache::freeBlocks(size_t cls) {
+    if (!enabled() || cls == 0 || cls >= NUM_SIZE_CLASSES) return 0;
+    size_t blocks = 0;
+    for (size_t cpu = 0; cpu < num_cpus_; ++cpu) {
+        const volatile uint64_t* words = reinterpret_cast<const volatile uint64_t*>(slabs_ + cpu * cpu_stride_);
+        blocks += static_cast<size_t>(words[cls] >> LIST_COUNT_SHIFT);
+    }
+    return blocks;
+}
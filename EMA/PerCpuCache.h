@@ -0,0 +1,59 @@
+#ifndef PER_CPU_CACHE_H
+#define PER_CPU_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "MemoryConfig.h"
+#include "SizeClass.h"
+
+// 每CPU缓存（可选模式，参考tcmalloc per-CPU cache）：以CPU而不是线程为单位缓存空闲块
+// - 借助Linux restartable sequences（rseq，由glibc为每个线程注册）：
+//   临界区内读取当前CPU号并修改该CPU的链表，被抢占或迁移时内核让其从头重试，
+//   因此快速路径既不加锁也没有原子操作
+// - 每个CPU每个级别一个空闲链表，链表头与块数打包在一个64位字中（低48位指针，高16位块数），
+//   一次普通store即可提交
+// - 缓存的内存与CPU数成正比，大量空闲线程不再各自滞留一份缓存
+// - 链表为空时从中心缓存取一批，超过上限时将一半归还中心缓存
+// - 仅支持x86_64且glibc已注册rseq的环境，否则enable()返回false，继续使用线程本地池
+class PerCpuCache {
+public:
+    // 当前环境是否支持（编译目标与glibc的rseq注册）
+    static bool supported();
+
+    // 启用每CPU缓存（一经启用不再关闭；不支持时返回false）
+    static bool enable();
+
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    // 分配一个cls级别的块：当前CPU链表为空时从中心缓存补充；当前线程不可用rseq或内存不足时返回nullptr
+    static void* allocate(size_t cls);
+
+    // 释放一个cls级别的块到当前CPU；当前线程不可用rseq时返回false（由调用方改走线程本地池）
+    static bool deallocate(void* ptr, size_t cls);
+
+    // 将调用线程当前所在CPU的缓存全部归还中心缓存，返回归还的字节数
+    static size_t drainCurrentCpu();
+
+    // 所有CPU缓存中的空闲字节数（无锁读取的快照）
+    static size_t freeBytes();
+
+    // 所有CPU缓存中cls级别的空闲块数（无锁读取的快照）
+    static size_t freeBlocks(size_t cls);
+
+private:
+    // CPU链表已满：连同ptr一起将一半归还中心缓存
+    static void overflow(void* ptr, size_t cls);
+
+    // CPU链表为空：从中心缓存取一批，返回其中一块，其余放入当前CPU
+    static void* refill(size_t cls);
+
+private:
+    static std::atomic_bool enabled_;
+    static char* slabs_;                          // 每CPU一段，每段为NUM_SIZE_CLASSES个链表字
+    static size_t cpu_stride_;                    // 每CPU一段的字节数（按缓存行取整）
+    static size_t num_cpus_;
+    static size_t limits_[NUM_SIZE_CLASSES];      // 每级别每CPU的块数上限
+};
+
+#endif // PER_CPU_CACHE_H
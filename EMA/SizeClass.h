@@ -0,0 +1,167 @@
+#ifndef SIZE_CLASS_H
+#define SIZE_CLASS_H
+
+#include <cstddef>
+#include <cstdint>
+#include "MemoryConfig.h"
+
+// 尺寸分级（size class）规则：
+//   - 尺寸级别按“最高位/8”为步长几何增长（8之后最小步长为MALLOC_ALIGNMENT），
+//     即 8,16,32,...,256 步长16；256~512 步长32 ... 每级内部浪费不超过12.5%
+//     （8~128区间步长16时浪费可达50%，换取与malloc一致的16字节对齐）
+//   - 查表索引：<=SMALL_LOOKUP_MAX 按8字节粒度，其上按128字节粒度（与tcmalloc一致），
+//     因此 sizeToClass 只需一次移位 + 一次查表
+//   - 级别0保留为“非池化”（超大内存），有效级别从1开始
+//   - 每个级别的Span页数：在内部浪费（页尾不足一块的部分）不超过1/8的前提下取最少页数；
+//     中等对象（> MAX_SMALL_SIZE）另要求Span不小于MEDIUM_SPAN_MIN_BYTES，一个Span即可满足一次批量取块
+//   - 对齐分配：Span起始地址按页对齐，大小为alignment整数倍的级别其所有块天然按alignment对齐；
+//     预先为每种对齐（32B ~ PAGE_SIZE）记录“不小于某级别且满足对齐的最小级别”，无需逐块填充
+const size_t SMALL_LOOKUP_MAX = 1024;   // 8字节粒度查表的上限
+
+// 计算查表索引（编译期可用）
+constexpr size_t sizeClassLookupIndex(size_t user_size) {
+    return user_size <= SMALL_LOOKUP_MAX ? (user_size + 7) >> 3
+                                         : (user_size + 127 + (120 << 7)) >> 7;
+}
+
+// 查表索引对应的最大用户大小（sizeClassLookupIndex的逆映射）
+constexpr size_t sizeClassLookupMaxSize(size_t index) {
+    return index <= (SMALL_LOOKUP_MAX >> 3) ? index << 3 : (index << 7) - (120 << 7);
+}
+
+// 尺寸级别步长：最高位的1/8；不足MALLOC_ALIGNMENT的级别步长为BLOCK_ALIGNMENT，
+// 其余步长不小于MALLOC_ALIGNMENT（保证16字节及以上的块都按16字节对齐）
+constexpr size_t sizeClassSpacing(size_t size) {
+    size_t high_bit = 1;
+    while ((high_bit << 1) <= size) high_bit <<= 1;
+    return size < MALLOC_ALIGNMENT ? BLOCK_ALIGNMENT
+                                   : (high_bit / 8 > MALLOC_ALIGNMENT ? high_bit / 8 : MALLOC_ALIGNMENT);
+}
+
+// 线程本地池与中心缓存之间每批移动的块数：约64KB一批，限制在[2, 32]
+constexpr size_t sizeClassBatchSize(size_t size) {
+    return 64 * 1024 / size < 2 ? 2 : (64 * 1024 / size > 32 ? 32 : 64 * 1024 / size);
+}
+
+// 线程本地池单个级别链表长度的动态上限：不超过THREAD_CACHE_CLASS_MAX_BYTES，且不小于一批
+constexpr size_t sizeClassMaxListLength(size_t size) {
+    return THREAD_CACHE_CLASS_MAX_BYTES / size < sizeClassBatchSize(size)
+               ? sizeClassBatchSize(size)
+               : (THREAD_CACHE_CLASS_MAX_BYTES / size > MAX_THREAD_LIST_LENGTH
+                      ? MAX_THREAD_LIST_LENGTH
+                      : THREAD_CACHE_CLASS_MAX_BYTES / size);
+}
+
+// 尺寸级别对应的Span页数（编译期可用）
+constexpr size_t sizeClassPages(size_t size) {
+    size_t pages = 1;
+    while (((pages << PAGE_SHIFT) % size) > ((pages << PAGE_SHIFT) >> 3) ||
+           (size > MAX_SMALL_SIZE && (pages << PAGE_SHIFT) < MEDIUM_SPAN_MIN_BYTES)) {
+        ++pages;
+    }
+    return pages;
+}
+
+// 以2为底的对数（编译期可用，value须为2的幂）
+constexpr size_t sizeClassLog2(size_t value) {
+    size_t shift = 0;
+    while ((static_cast<size_t>(1) << shift) < value) ++shift;
+    return shift;
+}
+
+// 需要查对齐级别表的对齐：MALLOC_ALIGNMENT之上直到PAGE_SIZE（更小的对齐所有级别都已满足）
+const size_t ALIGNED_CLASS_MIN_SHIFT = sizeClassLog2(MALLOC_ALIGNMENT) + 1;
+const size_t NUM_ALIGNED_LEVELS = PAGE_SHIFT + 1 - ALIGNED_CLASS_MIN_SHIFT;
+
+// 统计尺寸级别数量（含保留的级别0）
+constexpr size_t countSizeClasses() {
+    size_t count = 1;
+    for (size_t size = MIN_USER_SIZE; size <= MAX_USER_SIZE; size += sizeClassSpacing(size)) {
+        ++count;
+    }
+    return count;
+}
+
+const size_t NUM_SIZE_CLASSES = countSizeClasses();
+const size_t SIZE_CLASS_LOOKUP_LENGTH = sizeClassLookupIndex(MAX_USER_SIZE) + 1;
+
+static_assert(NUM_SIZE_CLASSES <= 256, "Size class index must fit in uint8_t");
+
+// 编译期生成的尺寸级别表
+struct SizeClassTable {
+    size_t class_to_size[NUM_SIZE_CLASSES];        // 级别 -> 用户可用大小
+    size_t class_to_batch[NUM_SIZE_CLASSES];       // 级别 -> 每批移动块数
+    size_t class_to_max_length[NUM_SIZE_CLASSES];  // 级别 -> 线程本地链表长度上限
+    size_t class_to_pages[NUM_SIZE_CLASSES];       // 级别 -> 每个Span的页数
+    uint8_t lookup_to_class[SIZE_CLASS_LOOKUP_LENGTH]; // 查表索引 -> 级别
+    uint8_t aligned_class[NUM_ALIGNED_LEVELS][NUM_SIZE_CLASSES]; // 对齐 × 级别 -> 满足对齐的最小级别（0表示无）
+
+    constexpr SizeClassTable()
+        : class_to_size(), class_to_batch(), class_to_max_length(), class_to_pages(),
+          lookup_to_class(), aligned_class() {
+        size_t cls = 1;
+        for (size_t size = MIN_USER_SIZE; size <= MAX_USER_SIZE; size += sizeClassSpacing(size)) {
+            class_to_batch[cls] = sizeClassBatchSize(size);
+            class_to_max_length[cls] = sizeClassMaxListLength(size);
+            class_to_pages[cls] = sizeClassPages(size);
+            class_to_size[cls++] = size;
+        }
+
+        cls = 1;
+        for (size_t index = 0; index < SIZE_CLASS_LOOKUP_LENGTH; ++index) {
+            size_t max_size = sizeClassLookupMaxSize(index);
+            while (class_to_size[cls] < max_size) ++cls;
+            lookup_to_class[index] = static_cast<uint8_t>(cls);
+        }
+
+        for (size_t level = 0; level < NUM_ALIGNED_LEVELS; ++level) {
+            size_t alignment = static_cast<size_t>(1) << (level + ALIGNED_CLASS_MIN_SHIFT);
+            size_t aligned = 0;   // 从大到小扫描，记录目前见到的最小对齐级别
+            for (size_t c = NUM_SIZE_CLASSES - 1; c > 0; --c) {
+                if (class_to_size[c] % alignment == 0) aligned = c;
+                aligned_class[level][c] = static_cast<uint8_t>(aligned);
+            }
+        }
+    }
+};
+
+// 尺寸级别查询接口（全部为O(1)查表）
+class SizeClass {
+public:
+    // 用户大小 -> 级别（调用方保证 user_size <= MAX_USER_SIZE）
+    static inline size_t sizeToClass(size_t user_size) {
+        return TABLE.lookup_to_class[sizeClassLookupIndex(user_size)];
+    }
+
+    // 级别 -> 用户可用大小
+    static inline size_t classToSize(size_t cls) {
+        return TABLE.class_to_size[cls];
+    }
+
+    // 级别 -> 与中心缓存之间每批移动的块数
+    static inline size_t numToMove(size_t cls) {
+        return TABLE.class_to_batch[cls];
+    }
+
+    // 级别 -> 线程本地链表长度上限（慢启动增长的终点）
+    static inline size_t maxListLength(size_t cls) {
+        return TABLE.class_to_max_length[cls];
+    }
+
+    // 级别 -> 每个Span的页数
+    static inline size_t classToPages(size_t cls) {
+        return TABLE.class_to_pages[cls];
+    }
+
+    // 满足alignment对齐（MALLOC_ALIGNMENT < alignment <= PAGE_SIZE，2的幂）且可容纳user_size的最小级别，
+    // 没有这样的池化级别时返回0（调用方保证 user_size <= MAX_USER_SIZE）
+    static inline size_t alignedClass(size_t user_size, size_t alignment) {
+        size_t level = static_cast<size_t>(__builtin_ctzl(alignment)) - ALIGNED_CLASS_MIN_SHIFT;
+        return TABLE.aligned_class[level][sizeToClass(user_size)];
+    }
+
+private:
+    static constexpr SizeClassTable TABLE{};
+};
+
+#endif // SIZE_CLASS_H
@@ -0,0 +1,75 @@
+#ifndef SPAN_H
+#define SPAN_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "MemoryConfig.h"
+
+class ThreadLocalMemoryPool;
+struct HeapSample;
+
+// 空闲块链表节点（复用块本身的内存，仅空闲时有效）
+// 块的尺寸级别记录在带外的Span中（经PageMap查询），使用中的块不携带任何头部
+struct FreeBlock {
+    FreeBlock* next;   // 下一个空闲块指针
+};
+static_assert(sizeof(FreeBlock) <= MIN_USER_SIZE, "Smallest block must hold a free list link");
+
+// Span：一段连续页的带外元数据（不再嵌入块头部）
+// 通过PageMap由任意页地址O(1)找到所属Span，进而得到尺寸级别
+struct Span {
+    // Span所处位置
+    enum Location : uint8_t {
+        IN_USE = 0,             // 已交给中心缓存切分（或作为大块内存使用）
+        ON_NORMAL_FREELIST,     // 在页堆空闲链表中，物理内存仍驻留
+        ON_RETURNED_FREELIST,   // 在页堆空闲链表中，物理内存已归还系统（madvise）
+    };
+
+    uintptr_t start_page = 0;   // 起始页号（地址 >> PAGE_SHIFT）
+    size_t num_pages = 0;       // 页数
+    size_t size_class = 0;      // 尺寸级别（0表示非池化）
+    Span* next = nullptr;       // 双向链表指针（页堆空闲链表 / 中心缓存的非空Span链表）
+    Span* prev = nullptr;
+    FreeBlock* objects = nullptr; // 本Span中空闲块链表（仅中心缓存持锁访问）
+    size_t ref_count = 0;       // 已分出（不在objects中）的块数，为0时整个Span可归还页堆
+    Location location = IN_USE;
+    uint8_t node = 0;           // 所属NUMA节点（即所属页堆），只与同节点的空闲Span合并
+    uint64_t free_time = 0;     // 进入页堆空闲链表的时间（steady_clock毫秒，用于衰减归还）
+    HeapSample* sample = nullptr; // 堆分析抽中的分配独占一个Span，记录其抽样信息（见HeapProfiler）
+
+    // 所属线程本地池（首次取走该Span块的线程）；其他线程释放的块经其远程释放队列归还
+    // nullptr表示无归属，释放到调用线程的本地池
+    std::atomic<ThreadLocalMemoryPool*> owner{nullptr};
+
+    void* startAddress() const {
+        return reinterpret_cast<void*>(start_page << PAGE_SHIFT);
+    }
+    size_t bytes() const { return num_pages << PAGE_SHIFT; }
+};
+
+// -------------------------- Span双向链表（带哨兵的循环链表） --------------------------
+inline void spanListInit(Span* list) {
+    list->next = list;
+    list->prev = list;
+}
+
+inline bool spanListEmpty(const Span* list) {
+    return list->next == list;
+}
+
+inline void spanListRemove(Span* span) {
+    span->prev->next = span->next;
+    span->next->prev = span->prev;
+    span->prev = nullptr;
+    span->next = nullptr;
+}
+
+inline void spanListPrepend(Span* list, Span* span) {
+    span->next = list->next;
+    span->prev = list;
+    list->next->prev = span;
+    list->next = span;
+}
+
+#endif // SPAN_H
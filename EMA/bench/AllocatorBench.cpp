@@ -0,0 +1,556 @@
+// 分配器对比基准：EMA / glibc malloc / MemoryPool<T>（reference/MemoryPool）/ MNN EagerBufferAllocator
+// 工作负载：
+//   larson        —— 每线程一组槽位随机替换，若干轮后槽位交给新线程继续（跨线程释放 + 线程更替）
+//   threadtest    —— 每线程反复分配一批固定大小对象后全部释放
+//   xmalloc       —— 生产者分配、消费者释放（成对线程，跨线程传递）
+//   random        —— 对数均匀分布的随机大小（16B~32KB），随机替换存活集合
+//   fixed         —— 64B固定大小对象的随机替换（对象池的典型场景）
+//   fragmentation —— 长时间运行：各阶段交替小/大对象，每阶段只保留少量长寿对象，观察RSS相对存活量的膨胀
+// 输出：每秒操作数、单次操作延迟p50/p99/p999（抽样）、运行期间的峰值RSS；线程数从1倍增到N
+// 用法：EMA_allocator_bench [--threads N] [--allocators ema,glibc,mempool,mnn]
+//                           [--workloads larson,...] [--scale F] [--format table|csv|json]
+// 非线程安全的分配器（MemoryPool、EagerBufferAllocator）每线程一个实例，且不参与跨线程释放的负载；
+// MemoryPool只能提供固定大小的对象，只参与固定大小的负载
+#include "MemoryManager.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#ifdef EMA_BENCH_WITH_MEMORYPOOL
+#include "MemoryPool.h"
+#endif
+#ifdef EMA_BENCH_WITH_MNN
+#include "core/BufferAllocator.hpp"
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const size_t LATENCY_SAMPLE_EVERY = 32;   // 每32次操作抽样计时一次
+const size_t FIXED_OBJECT_SIZE = 64;      // 固定大小负载的对象大小
+const long RSS_SAMPLE_INTERVAL_MS = 2;    // RSS采样间隔
+
+// -------------------------- 分配器适配 --------------------------
+// 一次分配的句柄：部分分配器释放时需要分配时返回的额外信息（如MNN的MemChunk）
+struct Block {
+    void* ptr = nullptr;
+    size_t size = 0;
+    void* base = nullptr;
+    size_t offset = 0;
+};
+
+class BenchAllocator {
+public:
+    virtual ~BenchAllocator() = default;
+    virtual bool allocate(size_t size, Block& block) = 0;
+    virtual void deallocate(Block& block) = 0;
+};
+
+class EmaAllocator : public BenchAllocator {
+public:
+    bool allocate(size_t size, Block& block) override {
+        block.ptr = MemoryManager::allocate(size);
+        block.size = size;
+        return block.ptr != nullptr;
+    }
+    void deallocate(Block& block) override { MemoryManager::deallocate(block.ptr); }
+};
+
+class GlibcAllocator : public BenchAllocator {
+public:
+    bool allocate(size_t size, Block& block) override {
+        block.ptr = std::malloc(size);
+        block.size = size;
+        return block.ptr != nullptr;
+    }
+    void deallocate(Block& block) override { std::free(block.ptr); }
+};
+
+#ifdef EMA_BENCH_WITH_MEMORYPOOL
+struct FixedObject {
+    alignas(16) char data[FIXED_OBJECT_SIZE];
+};
+
+class MemoryPoolAllocator : public BenchAllocator {
+public:
+    bool allocate(size_t size, Block& block) override {
+        if (size > FIXED_OBJECT_SIZE) return false;
+        block.ptr = pool_.allocate();
+        block.size = size;
+        return block.ptr != nullptr;
+    }
+    void deallocate(Block& block) override { pool_.deallocate(static_cast<FixedObject*>(block.ptr)); }
+
+private:
+    MemoryPool<FixedObject> pool_;
+};
+#endif
+
+#ifdef EMA_BENCH_WITH_MNN
+class MnnEagerAllocator : public BenchAllocator {
+public:
+    MnnEagerAllocator() : allocator_(MNN::BufferAllocator::Allocator::createDefault(), 16, 0) {}
+    bool allocate(size_t size, Block& block) override {
+        MNN::MemChunk chunk = allocator_.alloc(size);
+        if (chunk.invalid()) return false;
+        block.ptr = chunk.ptr();
+        block.size = size;
+        block.base = chunk.first;
+        block.offset = chunk.second;
+        return true;
+    }
+    void deallocate(Block& block) override { allocator_.free(MNN::MemChunk(block.base, block.offset)); }
+
+private:
+    MNN::EagerBufferAllocator allocator_;
+};
+#endif
+
+struct AllocatorInfo {
+    const char* name;
+    bool thread_safe;      // 可以在线程间共享并跨线程释放
+    size_t max_size;       // 支持的最大请求（0表示不限）
+    std::function<std::unique_ptr<BenchAllocator>()> create;
+};
+
+std::vector<AllocatorInfo> availableAllocators() {
+    std::vector<AllocatorInfo> list;
+    list.push_back({"ema", true, 0, [] { return std::unique_ptr<BenchAllocator>(new EmaAllocator()); }});
+    list.push_back({"glibc", true, 0, [] { return std::unique_ptr<BenchAllocator>(new GlibcAllocator()); }});
+#ifdef EMA_BENCH_WITH_MEMORYPOOL
+    list.push_back({"mempool", false, FIXED_OBJECT_SIZE,
+                    [] { return std::unique_ptr<BenchAllocator>(new MemoryPoolAllocator()); }});
+#endif
+#ifdef EMA_BENCH_WITH_MNN
+    list.push_back({"mnn", false, 0, [] { return std::unique_ptr<BenchAllocator>(new MnnEagerAllocator()); }});
+#endif
+    return list;
+}
+
+// -------------------------- 计时与RSS采样 --------------------------
+// 每线程的操作计数与抽样延迟
+class Recorder {
+public:
+    template <typename F>
+    void op(F&& f) {
+        if (++ops_ % LATENCY_SAMPLE_EVERY == 0) {
+            Clock::time_point begin = Clock::now();
+            f();
+            samples_.push_back(static_cast<uint32_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count()));
+        } else {
+            f();
+        }
+    }
+
+    size_t ops() const { return ops_; }
+    std::vector<uint32_t>& samples() { return samples_; }
+
+private:
+    size_t ops_ = 0;
+    std::vector<uint32_t> samples_;
+};
+
+// 当前RSS（字节），读取/proc/self/statm
+size_t currentRss() {
+    int fd = open("/proc/self/statm", O_RDONLY);
+    if (fd < 0) return 0;
+    char buffer[128];
+    ssize_t n = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if (n <= 0) return 0;
+    buffer[n] = '\0';
+    unsigned long size = 0;
+    unsigned long resident = 0;
+    if (std::sscanf(buffer, "%lu %lu", &size, &resident) != 2) return 0;
+    return static_cast<size_t>(resident) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+// 后台线程周期采样RSS，记录峰值
+class RssSampler {
+public:
+    RssSampler() : start_(currentRss()), peak_(start_) {
+        thread_ = std::thread([this] {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!stop_) {
+                cv_.wait_for(lock, std::chrono::milliseconds(RSS_SAMPLE_INTERVAL_MS));
+                peak_ = std::max(peak_, currentRss());
+            }
+        });
+    }
+    ~RssSampler() { stop(); }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stop_) return;
+            stop_ = true;
+        }
+        cv_.notify_one();
+        thread_.join();
+        peak_ = std::max(peak_, currentRss());
+    }
+
+    size_t start() const { return start_; }
+    size_t peak() const { return peak_; }
+
+private:
+    size_t start_;
+    size_t peak_;
+    bool stop_ = false;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread thread_;
+};
+
+// -------------------------- 工作负载 --------------------------
+inline uint32_t nextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// 16B~32KB对数均匀分布
+inline size_t logUniformSize(uint32_t& state) {
+    size_t shift = 4 + nextRandom(state) % 11;
+    size_t base = static_cast<size_t>(1) << shift;
+    return base + nextRandom(state) % base;
+}
+
+inline void touch(const Block& block) {
+    static_cast<char*>(block.ptr)[0] = 1;
+    static_cast<char*>(block.ptr)[block.size - 1] = 1;
+}
+
+struct WorkloadContext {
+    const AllocatorInfo* allocator;
+    size_t threads;
+    double scale;
+};
+
+// 运行threads个线程执行body(thread_index, allocator, recorder)，汇总计数与延迟
+struct RunResult {
+    size_t ops = 0;
+    std::vector<uint32_t> samples;
+};
+
+struct WorkloadInfo {
+    const char* name;
+    bool cross_thread;     // 需要跨线程释放
+    size_t max_size;       // 最大请求大小
+    std::function<void(const WorkloadContext&, RunResult&)> run;
+};
+
+template <typename Body>
+void runThreads(size_t threads, const WorkloadContext& ctx, RunResult& result, Body body) {
+    std::vector<Recorder> recorders(threads);
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            std::unique_ptr<BenchAllocator> allocator = ctx.allocator->create();
+            body(t, *allocator, recorders[t]);
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    for (auto& recorder : recorders) {
+        result.ops += recorder.ops();
+        result.samples.insert(result.samples.end(), recorder.samples().begin(), recorder.samples().end());
+    }
+}
+
+// larson：槽位数组在轮次之间交给新线程，新线程释放的是上一轮其他线程分配的对象
+void larson(const WorkloadContext& ctx, RunResult& result) {
+    const size_t slots = 1000;
+    const size_t rounds = 5;
+    const size_t ops_per_round = static_cast<size_t>(40000 * ctx.scale);
+    std::vector<std::vector<Block>> arrays(ctx.threads, std::vector<Block>(slots));
+    std::unique_ptr<BenchAllocator> shared = ctx.allocator->create();
+
+    for (size_t round = 0; round < rounds; ++round) {
+        runThreads(ctx.threads, ctx, result, [&](size_t t, BenchAllocator& allocator, Recorder& rec) {
+            // 轮转：本轮线程t接手上一轮线程t-1的槽位
+            std::vector<Block>& array = arrays[(t + round) % ctx.threads];
+            uint32_t state = static_cast<uint32_t>((t + 1) * 2654435761u + round);
+            for (size_t i = 0; i < ops_per_round; ++i) {
+                Block& block = array[nextRandom(state) % slots];
+                size_t size = 16 + nextRandom(state) % 497;
+                rec.op([&] {
+                    if (block.ptr) allocator.deallocate(block);
+                    if (allocator.allocate(size, block)) touch(block);
+                });
+            }
+        });
+    }
+    for (auto& array : arrays) {
+        for (auto& block : array) {
+            if (block.ptr) shared->deallocate(block);
+        }
+    }
+}
+
+// threadtest：每线程分配一批固定大小对象，再全部释放
+void threadtest(const WorkloadContext& ctx, RunResult& result) {
+    const size_t batch = 2000;
+    const size_t iterations = static_cast<size_t>(100 * ctx.scale);
+    runThreads(ctx.threads, ctx, result, [&](size_t, BenchAllocator& allocator, Recorder& rec) {
+        std::vector<Block> blocks(batch);
+        for (size_t it = 0; it < iterations; ++it) {
+            for (auto& block : blocks) {
+                rec.op([&] {
+                    if (allocator.allocate(FIXED_OBJECT_SIZE, block)) touch(block);
+                });
+            }
+            for (auto& block : blocks) {
+                rec.op([&] { allocator.deallocate(block); });
+            }
+        }
+    });
+}
+
+// xmalloc：成对线程，生产者分配后经批次交给消费者释放
+void xmalloc(const WorkloadContext& ctx, RunResult& result) {
+    const size_t per_producer = static_cast<size_t>(200000 * ctx.scale);
+    const size_t handoff = 256;
+    struct Queue {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::vector<std::vector<Block>> batches;
+        bool done = false;
+    };
+    size_t pairs = ctx.threads < 2 ? 1 : ctx.threads / 2;
+    std::vector<Queue> queues(pairs);
+    runThreads(pairs * 2, ctx, result, [&](size_t t, BenchAllocator& allocator, Recorder& rec) {
+        Queue& queue = queues[t / 2];
+        if (t % 2 == 0) {
+            uint32_t state = static_cast<uint32_t>((t + 1) * 7919u);
+            std::vector<Block> batch;
+            batch.reserve(handoff);
+            for (size_t i = 0; i < per_producer; ++i) {
+                Block block;
+                size_t size = 16 + nextRandom(state) % 2033;
+                rec.op([&] {
+                    if (allocator.allocate(size, block)) touch(block);
+                });
+                batch.push_back(block);
+                if (batch.size() == handoff || i + 1 == per_producer) {
+                    std::lock_guard<std::mutex> lock(queue.mutex);
+                    queue.batches.push_back(std::move(batch));
+                    batch.clear();
+                    batch.reserve(handoff);
+                    queue.cv.notify_one();
+                }
+            }
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.done = true;
+            queue.cv.notify_one();
+        } else {
+            for (;;) {
+                std::vector<std::vector<Block>> batches;
+                {
+                    std::unique_lock<std::mutex> lock(queue.mutex);
+                    queue.cv.wait(lock, [&] { return queue.done || !queue.batches.empty(); });
+                    if (queue.batches.empty()) break;
+                    batches.swap(queue.batches);
+                }
+                for (auto& batch : batches) {
+                    for (auto& block : batch) {
+                        rec.op([&] { allocator.deallocate(block); });
+                    }
+                }
+            }
+        }
+    });
+}
+
+// random / fixed：存活集合的随机替换
+void churn(const WorkloadContext& ctx, RunResult& result, bool fixed) {
+    const size_t slots = 4096;
+    const size_t ops = static_cast<size_t>((fixed ? 400000 : 200000) * ctx.scale);
+    runThreads(ctx.threads, ctx, result, [&](size_t t, BenchAllocator& allocator, Recorder& rec) {
+        std::vector<Block> live(slots);
+        uint32_t state = static_cast<uint32_t>((t + 1) * 40503u);
+        for (size_t i = 0; i < ops; ++i) {
+            Block& block = live[nextRandom(state) % slots];
+            size_t size = fixed ? FIXED_OBJECT_SIZE : logUniformSize(state);
+            rec.op([&] {
+                if (block.ptr) allocator.deallocate(block);
+                if (allocator.allocate(size, block)) touch(block);
+            });
+        }
+        for (auto& block : live) {
+            if (block.ptr) allocator.deallocate(block);
+        }
+    });
+}
+
+// fragmentation：阶段交替小对象（16~256B）与大对象（4~64KB），每阶段只保留约5%的对象到最后
+void fragmentation(const WorkloadContext& ctx, RunResult& result) {
+    const size_t phases = 20;
+    const size_t per_phase = static_cast<size_t>(20000 * ctx.scale);
+    runThreads(ctx.threads, ctx, result, [&](size_t t, BenchAllocator& allocator, Recorder& rec) {
+        std::vector<Block> survivors;
+        std::vector<Block> phase_blocks(per_phase);
+        uint32_t state = static_cast<uint32_t>((t + 1) * 69069u);
+        for (size_t phase = 0; phase < phases; ++phase) {
+            bool large = phase % 2 == 1;
+            for (auto& block : phase_blocks) {
+                size_t size = large ? 4096 + nextRandom(state) % 61441 : 16 + nextRandom(state) % 241;
+                rec.op([&] {
+                    if (allocator.allocate(size, block)) touch(block);
+                });
+            }
+            for (auto& block : phase_blocks) {
+                if (nextRandom(state) % 20 == 0) {
+                    survivors.push_back(block);
+                } else {
+                    rec.op([&] { allocator.deallocate(block); });
+                }
+            }
+        }
+        for (auto& block : survivors) allocator.deallocate(block);
+    });
+}
+
+std::vector<WorkloadInfo> availableWorkloads() {
+    return {
+        {"larson", true, 512, larson},
+        {"threadtest", false, FIXED_OBJECT_SIZE, threadtest},
+        {"xmalloc", true, 2048, xmalloc},
+        {"random", false, 32768, [](const WorkloadContext& ctx, RunResult& r) { churn(ctx, r, false); }},
+        {"fixed", false, FIXED_OBJECT_SIZE, [](const WorkloadContext& ctx, RunResult& r) { churn(ctx, r, true); }},
+        {"fragmentation", false, 65536, fragmentation},
+    };
+}
+
+// -------------------------- 结果输出 --------------------------
+struct Report {
+    std::string workload;
+    std::string allocator;
+    size_t threads;
+    size_t ops;
+    double seconds;
+    uint32_t p50;
+    uint32_t p99;
+    uint32_t p999;
+    size_t peak_rss;
+    size_t rss_growth;
+};
+
+uint32_t percentile(std::vector<uint32_t>& sorted, double q) {
+    if (sorted.empty()) return 0;
+    size_t index = static_cast<size_t>(q * static_cast<double>(sorted.size() - 1));
+    return sorted[index];
+}
+
+void printHeader(const std::string& format) {
+    if (format == "csv") {
+        std::printf("workload,allocator,threads,ops,seconds,ops_per_sec,p50_ns,p99_ns,p999_ns,"
+                    "peak_rss_kb,rss_growth_kb\n");
+    } else if (format == "table") {
+        std::printf("%-14s %-8s %7s %14s %9s %9s %9s %12s %12s\n", "workload", "alloc", "threads",
+                    "ops/s", "p50(ns)", "p99(ns)", "p999(ns)", "peakRSS(KB)", "growth(KB)");
+    }
+}
+
+void printReport(const Report& r, const std::string& format) {
+    double ops_per_sec = r.seconds > 0 ? static_cast<double>(r.ops) / r.seconds : 0;
+    if (format == "csv") {
+        std::printf("%s,%s,%zu,%zu,%.6f,%.0f,%u,%u,%u,%zu,%zu\n", r.workload.c_str(), r.allocator.c_str(),
+                    r.threads, r.ops, r.seconds, ops_per_sec, r.p50, r.p99, r.p999, r.peak_rss / 1024,
+                    r.rss_growth / 1024);
+    } else if (format == "json") {
+        std::printf("{\"workload\":\"%s\",\"allocator\":\"%s\",\"threads\":%zu,\"ops\":%zu,\"seconds\":%.6f,"
+                    "\"ops_per_sec\":%.0f,\"p50_ns\":%u,\"p99_ns\":%u,\"p999_ns\":%u,\"peak_rss_kb\":%zu,"
+                    "\"rss_growth_kb\":%zu}\n",
+                    r.workload.c_str(), r.allocator.c_str(), r.threads, r.ops, r.seconds, ops_per_sec, r.p50,
+                    r.p99, r.p999, r.peak_rss / 1024, r.rss_growth / 1024);
+    } else {
+        std::printf("%-14s %-8s %7zu %14.0f %9u %9u %9u %12zu %12zu\n", r.workload.c_str(), r.allocator.c_str(),
+                    r.threads, ops_per_sec, r.p50, r.p99, r.p999, r.peak_rss / 1024, r.rss_growth / 1024);
+    }
+    std::fflush(stdout);
+}
+
+bool selected(const std::string& list, const char* name) {
+    if (list.empty()) return true;
+    std::string padded = "," + list + ",";
+    return padded.find("," + std::string(name) + ",") != std::string::npos;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t max_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    std::string allocators;
+    std::string workloads;
+    std::string format = "table";
+    double scale = 1.0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (arg == "--threads" && value) {
+            max_threads = static_cast<size_t>(std::atoi(value));
+        } else if (arg == "--allocators" && value) {
+            allocators = value;
+        } else if (arg == "--workloads" && value) {
+            workloads = value;
+        } else if (arg == "--scale" && value) {
+            scale = std::atof(value);
+        } else if (arg == "--format" && value) {
+            format = value;
+        } else {
+            std::fprintf(stderr,
+                         "usage: %s [--threads N] [--allocators ema,glibc,mempool,mnn] "
+                         "[--workloads larson,threadtest,xmalloc,random,fixed,fragmentation] "
+                         "[--scale F] [--format table|csv|json]\n",
+                         argv[0]);
+            return 1;
+        }
+        ++i;
+    }
+    if (max_threads == 0 || scale <= 0) return 1;
+
+    printHeader(format);
+    for (const WorkloadInfo& workload : availableWorkloads()) {
+        if (!selected(workloads, workload.name)) continue;
+        for (const AllocatorInfo& allocator : availableAllocators()) {
+            if (!selected(allocators, allocator.name)) continue;
+            if (workload.cross_thread && !allocator.thread_safe) continue;
+            if (allocator.max_size != 0 && workload.max_size > allocator.max_size) continue;
+
+            for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+                WorkloadContext ctx{&allocator, threads, scale};
+                RunResult result;
+                RssSampler rss;
+                Clock::time_point begin = Clock::now();
+                workload.run(ctx, result);
+                double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+                rss.stop();
+
+                std::sort(result.samples.begin(), result.samples.end());
+                Report report{workload.name, allocator.name, threads, result.ops, seconds,
+                              percentile(result.samples, 0.50), percentile(result.samples, 0.99),
+                              percentile(result.samples, 0.999), rss.peak(), rss.peak() - rss.start()};
+                printReport(report, format);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,146 @@
+// 多线程扩展性基准：1~64线程下分配/释放吞吐量
+// 同一份源码编译为两个目标：
+//   EMA_scaling_bench              —— 每个尺寸级别独立加锁的中心缓存
+//   EMA_scaling_bench_single_lock  —— 定义EMA_CENTRAL_SINGLE_LOCK，所有级别共用一把锁（模拟原单锁设计）
+// 用法：EMA_scaling_bench [最大线程数] [percpu]，第二个参数为percpu时使用每CPU缓存模式
+#include "MemoryManager.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const size_t OPS_PER_THREAD = 200000;   // 每线程分配+释放的次数
+const size_t LIVE_SLOTS = 256;          // 每线程同时存活的块数
+const size_t SHORT_THREAD_OPS = 2000;   // 短生命周期线程每个的操作数
+const size_t MAX_BENCH_SIZE = 2048;     // 随机请求大小的上限（小对象）
+
+// 简单的线程内伪随机数（xorshift）
+inline uint32_t nextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+inline size_t randomSize(uint32_t& state) {
+    return 8 + nextRandom(state) % MAX_BENCH_SIZE;
+}
+
+// 工作负载1：每线程随机大小的分配/释放（本地缓存频繁与中心缓存交换批次）
+void localChurn(size_t thread_id) {
+    uint32_t state = static_cast<uint32_t>(thread_id * 2654435761u + 1);
+    void* slots[LIVE_SLOTS] = {};
+    for (size_t i = 0; i < OPS_PER_THREAD; ++i) {
+        size_t slot = nextRandom(state) % LIVE_SLOTS;
+        if (slots[slot]) MemoryManager::deallocate(slots[slot]);
+        slots[slot] = MemoryManager::allocate(randomSize(state));
+    }
+    for (size_t i = 0; i < LIVE_SLOTS; ++i) {
+        if (slots[i]) MemoryManager::deallocate(slots[i]);
+    }
+}
+
+// 工作负载2：反复创建短生命周期线程（每次线程退出都会把本地缓存转移给中心缓存）
+void shortLivedThreads(size_t thread_id) {
+    const size_t rounds = OPS_PER_THREAD / SHORT_THREAD_OPS;
+    for (size_t r = 0; r < rounds; ++r) {
+        std::thread worker([thread_id, r]() {
+            uint32_t state = static_cast<uint32_t>((thread_id + 1) * 40503u + r);
+            void* slots[64] = {};
+            for (size_t i = 0; i < SHORT_THREAD_OPS; ++i) {
+                size_t slot = nextRandom(state) % 64;
+                if (slots[slot]) MemoryManager::deallocate(slots[slot]);
+                slots[slot] = MemoryManager::allocate(randomSize(state));
+            }
+            for (size_t i = 0; i < 64; ++i) {
+                if (slots[i]) MemoryManager::deallocate(slots[i]);
+            }
+        });
+        worker.join();
+    }
+}
+
+// 工作负载3：生产者/消费者（偶数线程分配，奇数线程释放，跨线程传递）
+struct Channel {
+    static const size_t CAPACITY = 1024;
+    std::atomic<void*> slots[CAPACITY];
+    Channel() {
+        for (size_t i = 0; i < CAPACITY; ++i) slots[i].store(nullptr, std::memory_order_relaxed);
+    }
+};
+
+std::vector<Channel>* channels = nullptr;
+
+void producerConsumer(size_t thread_id) {
+    Channel& channel = (*channels)[thread_id / 2];
+    const size_t count = OPS_PER_THREAD;
+    if (thread_id % 2 == 0) {
+        uint32_t state = static_cast<uint32_t>(thread_id * 7919u + 3);
+        for (size_t i = 0; i < count; ++i) {
+            std::atomic<void*>& slot = channel.slots[i % Channel::CAPACITY];
+            void* p = MemoryManager::allocate(randomSize(state));
+            while (slot.load(std::memory_order_acquire) != nullptr) std::this_thread::yield();
+            slot.store(p, std::memory_order_release);
+        }
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            std::atomic<void*>& slot = channel.slots[i % Channel::CAPACITY];
+            void* p = nullptr;
+            while ((p = slot.exchange(nullptr, std::memory_order_acquire)) == nullptr) {
+                std::this_thread::yield();
+            }
+            MemoryManager::deallocate(p);
+        }
+    }
+}
+
+// 运行一轮并返回每秒操作数（一次分配+一次释放计为一次操作）
+double runWorkload(const std::function<void(size_t)>& task, size_t threads, size_t ops) {
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < threads; ++i) workers.emplace_back(task, i);
+    for (auto& worker : workers) worker.join();
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - begin).count();
+    return static_cast<double>(ops) / seconds;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t max_threads = argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 64;
+    if (argc > 2 && std::string(argv[2]) == "percpu" && !MemoryManager::enablePerCpuCache()) {
+        std::printf("per-CPU cache not supported on this system\n");
+        return 1;
+    }
+
+#ifdef EMA_CENTRAL_SINGLE_LOCK
+    std::printf("central cache: single lock\n");
+#else
+    std::printf("central cache: per-size-class locks\n");
+#endif
+    std::printf("front-end cache: %s\n", PerCpuCache::enabled() ? "per-CPU (rseq)" : "thread-local");
+    std::printf("%8s %16s %16s %16s\n", "threads", "local(ops/s)", "exit(ops/s)", "prodcons(ops/s)");
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        double local = runWorkload(localChurn, threads, threads * OPS_PER_THREAD);
+        double exiting = runWorkload(shortLivedThreads, threads, threads * OPS_PER_THREAD);
+
+        // 生产者/消费者至少需要一对线程
+        size_t pc_threads = threads < 2 ? 2 : threads;
+        std::vector<Channel> pc_channels(pc_threads / 2);
+        channels = &pc_channels;
+        double prodcons = runWorkload(producerConsumer, pc_threads, pc_threads / 2 * OPS_PER_THREAD);
+        channels = nullptr;
+
+        std::printf("%8zu %16.0f %16.0f %16.0f\n", threads, local, exiting, prodcons);
+    }
+    return 0;
+}
@@ -0,0 +1,170 @@
+// malloc/free/operator new替代库：所有标准分配接口转发到MemoryManager
+// - 直接链接或通过LD_PRELOAD加载（libema_malloc.so）
+// - 库内MemoryManager以EMA_INTERPOSE编译：不会回退调用系统malloc/free
+// - 已知大小的operator delete按大小查表，跳过PageMap查询
+// - 环境变量EMA_PER_CPU_CACHE=1：加载时切换为每CPU缓存模式（不支持时保持线程本地池）
+// - 环境变量EMA_HEAP_PROFILE=<文件>：加载时开启抽样堆分析，进程退出时写出分析文件
+//   （EMA_HEAP_SAMPLE_INTERVAL=<字节>指定平均抽样间隔）；运行中可调用ema_dump_heap_profile按需写出
+#include "MemoryManager.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#define EMA_EXPORT extern "C" __attribute__((visibility("default")))
+
+namespace {
+
+bool validAlignment(size_t alignment) {
+    return alignment != 0 && (alignment & (alignment - 1)) == 0;
+}
+
+// operator new语义：失败时调用new_handler重试，没有handler时抛出std::bad_alloc（nothrow版本返回nullptr）
+void* newImpl(size_t size, size_t alignment, bool nothrow) {
+    for (;;) {
+        void* p = alignment > MALLOC_ALIGNMENT ? MemoryManager::allocateAligned(size, alignment) : MemoryManager::allocate(size);
+        if (p) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            if (nothrow) return nullptr;
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+// 库加载时读取配置（getenv不分配内存，可在任何分配发生前安全调用）
+const char* heap_profile_path = nullptr;
+
+__attribute__((constructor)) void configureFromEnvironment() {
+    const char* per_cpu = getenv("EMA_PER_CPU_CACHE");
+    if (per_cpu && per_cpu[0] == '1') MemoryManager::enablePerCpuCache();
+
+    heap_profile_path = getenv("EMA_HEAP_PROFILE");
+    if (heap_profile_path && heap_profile_path[0] != '\0') {
+        const char* interval = getenv("EMA_HEAP_SAMPLE_INTERVAL");
+        MemoryManager::startHeapProfiling(interval ? strtoul(interval, nullptr, 10) : 0);
+    }
+}
+
+__attribute__((destructor)) void writeHeapProfileAtExit() {
+    if (heap_profile_path && heap_profile_path[0] != '\0') MemoryManager::dumpHeapProfile(heap_profile_path);
+}
+
+} // namespace
+
+// -------------------------- C分配接口 --------------------------
+EMA_EXPORT void* malloc(size_t size) {
+    void* p = MemoryManager::allocate(size);
+    if (!p) errno = ENOMEM;
+    return p;
+}
+
+EMA_EXPORT void free(void* ptr) {
+    MemoryManager::deallocate(ptr);
+}
+
+EMA_EXPORT void cfree(void* ptr) {
+    MemoryManager::deallocate(ptr);
+}
+
+EMA_EXPORT void* calloc(size_t count, size_t size) {
+    if (size != 0 && count > SIZE_MAX / size) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    size_t bytes = count * size;
+    void* p = MemoryManager::allocate(bytes);
+    if (!p) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    memset(p, 0, bytes);
+    return p;
+}
+
+EMA_EXPORT void* realloc(void* ptr, size_t size) {
+    void* p = MemoryManager::reallocate(ptr, size);
+    if (!p && size != 0) errno = ENOMEM;
+    return p;
+}
+
+EMA_EXPORT int posix_memalign(void** result, size_t alignment, size_t size) {
+    if (!validAlignment(alignment) || alignment % sizeof(void*) != 0) return EINVAL;
+    void* p = MemoryManager::allocateAligned(size, alignment);
+    if (!p) return ENOMEM;
+    *result = p;
+    return 0;
+}
+
+EMA_EXPORT void* aligned_alloc(size_t alignment, size_t size) {
+    if (!validAlignment(alignment)) {
+        errno = EINVAL;
+        return nullptr;
+    }
+    void* p = MemoryManager::allocateAligned(size, alignment);
+    if (!p) errno = ENOMEM;
+    return p;
+}
+
+EMA_EXPORT void* memalign(size_t alignment, size_t size) {
+    return aligned_alloc(alignment, size);
+}
+
+EMA_EXPORT void* valloc(size_t size) {
+    return aligned_alloc(PAGE_SIZE, size);
+}
+
+EMA_EXPORT void* pvalloc(size_t size) {
+    size_t rounded = (size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    return aligned_alloc(PAGE_SIZE, rounded == 0 ? PAGE_SIZE : rounded);
+}
+
+EMA_EXPORT size_t malloc_usable_size(void* ptr) {
+    return MemoryManager::usableSize(ptr);
+}
+
+// 按需写出堆分析文件（程序可经dlsym查找调用），未开启过抽样时文件中没有记录
+EMA_EXPORT int ema_dump_heap_profile(const char* path) {
+    return MemoryManager::dumpHeapProfile(path) ? 0 : -1;
+}
+
+// -------------------------- operator new/delete --------------------------
+void* operator new(size_t size) { return newImpl(size, 0, false); }
+void* operator new[](size_t size) { return newImpl(size, 0, false); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return newImpl(size, 0, true); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return newImpl(size, 0, true); }
+
+void operator delete(void* ptr) noexcept { MemoryManager::deallocate(ptr); }
+void operator delete[](void* ptr) noexcept { MemoryManager::deallocate(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { MemoryManager::deallocate(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { MemoryManager::deallocate(ptr); }
+
+// 已知大小：按大小查表得到级别，跳过PageMap
+void operator delete(void* ptr, size_t size) noexcept { MemoryManager::deallocate(ptr, size); }
+void operator delete[](void* ptr, size_t size) noexcept { MemoryManager::deallocate(ptr, size); }
+
+// 对齐版本：分配时可能选用了更大的级别，释放统一经PageMap查询
+void* operator new(size_t size, std::align_val_t alignment) {
+    return newImpl(size, static_cast<size_t>(alignment), false);
+}
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return newImpl(size, static_cast<size_t>(alignment), false);
+}
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return newImpl(size, static_cast<size_t>(alignment), true);
+}
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return newImpl(size, static_cast<size_t>(alignment), true);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept { MemoryManager::deallocate(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { MemoryManager::deallocate(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    MemoryManager::deallocate(ptr);
+}
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    MemoryManager::deallocate(ptr);
+}
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { MemoryManager::deallocate(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { MemoryManager::deallocate(ptr); }
@@ -27,8 +27,8 @@ void threadTask(int threadId) {
     // 分配不同大小的内存（池化内存 + 超大内存）
     void* p1 = MemoryManager::allocate(64);    // 池化内存（64B用户可用）
     void* p2 = MemoryManager::allocate(1024);  // 池化内存（1024B用户可用）
-    void* p3 = MemoryManager::allocate(4096);  // 超大内存（>2048B，直接malloc）
-    void* p4 = MemoryManager::allocate(15);    // 动态块大小（15B→对齐后24B总大小）
+    void* p3 = MemoryManager::allocate(4096);  // 中等内存（4096B，多页Span）
+    void* p4 = MemoryManager::allocate(15);    // 查表得到16B尺寸级别（15B→16B）
     void* p5 = MemoryManager::allocate(0);     // 0字节→默认MIN_USER_SIZE（8B）
 
     std::ostringstream oss;
@@ -76,6 +76,9 @@ int main() {
     // 再次打印全局统计（验证复用和释放）
     printStats("Global Memory Pool After Main Thread", MemoryManager::getGlobalStats());
 
+    // 按级别与线程本地池的详细统计
+    mutex_print(MemoryManager::dumpStats());
+
     std::cout << "\nMemory Manager Test End\n";
     return 0;
 }
\ No newline at end of file
@@ -284,6 +284,31 @@ void *MNNMmapFile(file_t file, size_t size) {
 #endif
 }
 
+void *MNNMmapFileReadOnly(file_t file, size_t size) {
+  if (file == INVALID_FILE || MNNGetFileSize(file) < size) {
+    return nullptr;
+  }
+#if defined(WIN32) || defined(_WIN32) || defined(_WIN64) || defined(_MSC_VER)
+  HANDLE hFileMapping =
+      CreateFileMapping(file, NULL, PAGE_READONLY, (size >> 32) & 0xffffffff,
+                        size & 0xffffffff, NULL);
+  if (hFileMapping == NULL) {
+    MNN_ERROR("MNN: Mmap failed\n");
+    return nullptr;
+  }
+  void *addr = MapViewOfFile(hFileMapping, FILE_MAP_READ, 0, 0, size);
+  CloseHandle(hFileMapping);
+  return addr;
+#else
+  void *addr = mmap(NULL, size, PROT_READ, MAP_SHARED, file, 0);
+  if (addr == MAP_FAILED) {
+    MNN_ERROR("MNN: Mmap failed\n");
+    return nullptr;
+  }
+  return addr;
+#endif
+}
+
 ErrorCode MNNUnmapFile(void *addr, size_t size) {
 #if defined(WIN32) || defined(_WIN32) || defined(_WIN64) || defined(_MSC_VER)
   if (!UnmapViewOfFile(addr)) {
@@ -176,6 +176,17 @@ MNN_PUBLIC ErrorCode MNNSetFilePointer(file_t file, size_t offset);
 */
 MNN_PUBLIC void * MNNMmapFile(file_t file, size_t size);
 
+/*=============================================================================================
+**  @brief      Memory-map the file read-only, sharing the kernel page cache
+**  @param      file -- handle of the file, opened with MNN_FILE_READ at least
+**              size -- mapped length
+**  @return     If succeeded, returns the start address of the mapped space
+**              If failed, return nullptr
+**  @warning    Writing to the mapped space is not allowed
+**              Release it with MNNUnmapFile()
+*/
+MNN_PUBLIC void * MNNMmapFileReadOnly(file_t file, size_t size);
+
 /*=============================================================================================
 **  @brief      Unmap a previously mapped memory space
 **  @param      addr -- start address of the mapped space
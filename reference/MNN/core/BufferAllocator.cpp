@@ -7,9 +7,16 @@
 //
 
 #include "core/BufferAllocator.hpp"
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include <numeric>
 #include <string>
 #include "MNNFileUtils.h"
 #include "core/Macro.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 // #define DUMP_USAGE
 // #define MNN_DEBUG_MEMORY
@@ -147,6 +154,215 @@ public:
     }
   }
 };
+#if !(defined(WIN32) || defined(_WIN32) || defined(_WIN64) || defined(_MSC_VER))
+// One backing file (or an anonymous memfd) mapped into a reserved virtual
+// range; chunks are sub-allocated inside it instead of one file per chunk.
+class PooledMmapAllocator : public BufferAllocator::Allocator {
+private:
+  uint8_t *mBase = nullptr;
+  size_t mReserved = 0;
+  size_t mMapped = 0;   // mapped and backed by the file, from mBase
+  size_t mExisting = 0; // bytes of the file found on disk when opened
+  size_t mPageSize;
+  file_t mFile = INVALID_FILE;
+  std::string mFileName;
+  bool mRemove;
+  bool mNewMmap = false;
+  bool mSynced = false;
+  // free ranges < offset, size > below mMapped, and used chunk sizes
+  std::map<size_t, size_t> mFree;
+  std::map<size_t, size_t> mUsed;
+
+  bool grow(size_t end) {
+    // map geometrically so growing stays a handful of syscalls, the file is
+    // extended sparsely and only chunk ranges get blocks allocated
+    size_t target = ALIMAX(end, ALIMIN(mReserved, ALIMAX(mMapped * 2,
+                                                         (size_t)64 << 20)));
+    target = UP_DIV(target, mPageSize) * mPageSize;
+    if (target > mReserved) {
+      return false;
+    }
+    if (MNNGetFileSize(mFile) < target &&
+        NO_ERROR != MNNSetFileSize(mFile, target)) {
+      return false;
+    }
+    void *addr = mmap(mBase + mMapped, target - mMapped, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_FIXED, mFile, mMapped);
+    if (addr == MAP_FAILED) {
+      return false;
+    }
+    if (mFree.empty() || mFree.rbegin()->first + mFree.rbegin()->second != mMapped) {
+      mFree[mMapped] = target - mMapped;
+    } else {
+      mFree.rbegin()->second += target - mMapped;
+    }
+    mMapped = target;
+    return true;
+  }
+
+public:
+  PooledMmapAllocator(const char *dirName, const char *prefix,
+                      const char *posfix, bool autoRemove, size_t reserveSize)
+      : mRemove(autoRemove) {
+    mPageSize = (size_t)sysconf(_SC_PAGESIZE);
+    if (0 == reserveSize) {
+      reserveSize = sizeof(void *) >= 8 ? ((size_t)1 << 36) : ((size_t)1 << 30);
+    }
+    mReserved = UP_DIV(reserveSize, mPageSize) * mPageSize;
+#ifdef __linux__
+    if (nullptr == dirName) {
+      mFile = memfd_create("MNNMmapPool", MFD_CLOEXEC);
+      mRemove = false;
+    }
+#endif
+    if (INVALID_FILE == mFile) {
+      std::string name = std::string(prefix ? prefix : "") + "pool." +
+                         std::string(posfix ? posfix : "");
+      if (nullptr != dirName) {
+        if (!MNNCreateDir(dirName)) {
+          MNN_ERROR("%s not exist\n", dirName);
+        }
+        mFileName = MNNFilePathConcat(dirName, name);
+      } else {
+        mFileName = name;
+      }
+      if (MNNFileExist(mFileName.c_str())) {
+        mFile = MNNOpenFile(mFileName.c_str(), MNN_FILE_READ | MNN_FILE_WRITE);
+        mExisting = MNNGetFileSize(mFile);
+      } else {
+        mFile = MNNCreateFile(mFileName.c_str());
+        mNewMmap = true;
+      }
+    }
+    if (INVALID_FILE == mFile) {
+      MNN_ERROR("Create mmap pool file failed\n");
+      return;
+    }
+    void *addr = mmap(NULL, mReserved, PROT_NONE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (addr == MAP_FAILED) {
+      MNN_ERROR("Reserve %lu for mmap pool failed\n", (unsigned long)mReserved);
+      return;
+    }
+    mBase = static_cast<uint8_t *>(addr);
+    if (mExisting > 0 && !grow(ALIMIN(mExisting, mReserved))) {
+      MNN_ERROR("Map existing mmap pool file failed\n");
+    }
+  }
+  virtual ~PooledMmapAllocator() {
+    if (nullptr != mBase) {
+      munmap(mBase, mReserved);
+    }
+    if (INVALID_FILE != mFile) {
+      MNNCloseFile(mFile);
+    }
+    if (mRemove && !mFileName.empty()) {
+      MNNRemoveFile(mFileName.c_str());
+    }
+  }
+  virtual MemChunk onAlloc(size_t size, size_t align) override {
+    MNN_ASSERT(size > 0);
+    MNN_ASSERT(!mSynced);
+    if (nullptr == mBase) {
+      return MemChunk();
+    }
+    // chunks start on a page so advice and hole punching stay per chunk
+    align = ALIMAX(align, mPageSize);
+    size = UP_DIV(size, mPageSize) * mPageSize;
+    // first fit keeps the layout the same across runs with the same requests
+    size_t offset = 0;
+    auto iter = mFree.begin();
+    for (; iter != mFree.end(); ++iter) {
+      offset = UP_DIV(iter->first, align) * align;
+      if (offset + size <= iter->first + iter->second) {
+        break;
+      }
+    }
+    if (iter == mFree.end()) {
+      size_t start = mMapped;
+      if (!mFree.empty() &&
+          mFree.rbegin()->first + mFree.rbegin()->second == mMapped) {
+        start = mFree.rbegin()->first;
+      }
+      offset = UP_DIV(start, align) * align;
+      if (!grow(offset + size)) {
+        MNN_ERROR("Mmap pool of %lu exhausted\n", (unsigned long)mReserved);
+        return MemChunk();
+      }
+      iter = mFree.find(start);
+      MNN_ASSERT(iter != mFree.end());
+    }
+    // carve [offset, offset + size) out of the free range
+    size_t rangeBegin = iter->first, rangeEnd = iter->first + iter->second;
+    mFree.erase(iter);
+    if (rangeBegin < offset) {
+      mFree[rangeBegin] = offset - rangeBegin;
+    }
+    if (offset + size < rangeEnd) {
+      mFree[offset + size] = rangeEnd - offset - size;
+    }
+    mUsed[offset] = size;
+    uint8_t *ptr = mBase + offset;
+#ifdef __linux__
+    // give the range real blocks so a full disk fails here, not as SIGBUS
+    if (0 != fallocate(mFile, 0, offset, size) && EOPNOTSUPP != errno) {
+      MNN_ERROR("fallocate %lu for mmap pool failed\n", (unsigned long)size);
+    }
+#endif
+    if (offset < mExisting) {
+      // data from a previous run is read back, start the readahead now
+      madvise(ptr, size, MADV_WILLNEED);
+    } else {
+      madvise(ptr, size, MADV_SEQUENTIAL);
+    }
+    return MemChunk(ptr, 0);
+  }
+  virtual void onRelease(MemChunk chunk) override {
+    MNN_ASSERT(chunk.second == 0);
+    size_t offset = static_cast<uint8_t *>(chunk.first) - mBase;
+    auto iter = mUsed.find(offset);
+    if (nullptr == mBase || iter == mUsed.end()) {
+      MNN_ASSERT(false);
+      MNN_ERROR("Invalid free for PooledMmapAllocator\n");
+      return;
+    }
+    size_t size = iter->second;
+    mUsed.erase(iter);
+#ifdef __linux__
+    // the content is dead: drop its page cache and disk blocks
+    fallocate(mFile, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, size);
+#endif
+    // return the range, merging with free neighbours
+    auto next = mFree.lower_bound(offset);
+    if (next != mFree.end() && offset + size == next->first) {
+      size += next->second;
+      next = mFree.erase(next);
+    }
+    if (next != mFree.begin()) {
+      auto prev = std::prev(next);
+      if (prev->first + prev->second == offset) {
+        prev->second += size;
+        return;
+      }
+    }
+    mFree[offset] = size;
+  }
+  virtual void sync() override {
+    if (mSynced) {
+      return;
+    }
+    if (!mRemove && mNewMmap && nullptr != mBase) {
+      // write back asynchronously, the marker file records a complete cache
+      for (auto &iter : mUsed) {
+        msync(mBase + iter.first, iter.second, MS_ASYNC);
+      }
+      std::string cacheName = mFileName + ".sync";
+      MNNCloseFile(MNNCreateFile(cacheName.c_str()));
+      mSynced = true;
+    }
+  }
+};
+#endif
 class RecurseAllocator : public BufferAllocator::Allocator {
 public:
   RecurseAllocator(BufferAllocator *parent) { mParent = parent; }
@@ -176,6 +392,22 @@ BufferAllocator::Allocator::createMmap(const char *dirName, const char *prefix,
   return _res;
 }
 
+std::shared_ptr<BufferAllocator::Allocator>
+BufferAllocator::Allocator::createMmapPool(const char *dirName,
+                                           const char *prefix,
+                                           const char *posfix, bool autoRemove,
+                                           size_t reserveSize) {
+  std::shared_ptr<BufferAllocator::Allocator> _res;
+#if defined(WIN32) || defined(_WIN32) || defined(_WIN64) || defined(_MSC_VER)
+  // no reserved range support, fall back to one file per chunk
+  _res.reset(new MmapAllocator(dirName, prefix, posfix, autoRemove));
+#else
+  _res.reset(new PooledMmapAllocator(dirName, prefix, posfix, autoRemove,
+                                     reserveSize));
+#endif
+  return _res;
+}
+
 std::shared_ptr<BufferAllocator::Allocator>
 BufferAllocator::Allocator::createRecurse(BufferAllocator *parent) {
   std::shared_ptr<BufferAllocator::Allocator> _res;
@@ -183,14 +415,256 @@ BufferAllocator::Allocator::createRecurse(BufferAllocator *parent) {
   return _res;
 }
 
-EagerBufferAllocator::Node::~Node() {
-  MNN_PRINT("Node::~Node(), %p, %zu, %p, %zu\r\n", this->parent.get(),
-            this->size, this->pointer.first, this->pointer.second);
+// count leading / trailing zeros of a non-zero value
+static inline int _clz64(uint64_t v) {
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanReverse64(&index, v);
+  return 63 - (int)index;
+#else
+  return __builtin_clzll(v);
+#endif
+}
+static inline int _ctz64(uint64_t v) {
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward64(&index, v);
+  return (int)index;
+#else
+  return __builtin_ctzll(v);
+#endif
+}
+
+EagerBufferAllocator::FreeIndex::FreeIndex() {
+  ::memset(mSlBitmap, 0, sizeof(mSlBitmap));
+  ::memset(mBins, 0, sizeof(mBins));
+}
+
+void EagerBufferAllocator::FreeIndex::mapping(size_t size, int *fl, int *sl) {
+  if (size < (size_t)SL_COUNT) {
+    *fl = 0;
+    *sl = (int)size;
+    return;
+  }
+  int log2 = 63 - _clz64((uint64_t)size);
+  *fl = log2 - SL_BITS + 1;
+  *sl = (int)(size >> (log2 - SL_BITS)) - SL_COUNT;
+}
+
+void EagerBufferAllocator::FreeIndex::insert(Node *node) {
+  int fl, sl;
+  mapping(node->size, &fl, &sl);
+  node->owner = this;
+  node->prevFree = nullptr;
+  node->nextFree = mBins[fl][sl];
+  if (nullptr != node->nextFree) {
+    node->nextFree->prevFree = node;
+  }
+  mBins[fl][sl] = node;
+  mFlBitmap |= 1ULL << fl;
+  mSlBitmap[fl] |= 1U << sl;
+}
+
+void EagerBufferAllocator::FreeIndex::remove(Node *node) {
+  MNN_ASSERT(node->owner == this);
+  int fl, sl;
+  mapping(node->size, &fl, &sl);
+  if (nullptr != node->prevFree) {
+    node->prevFree->nextFree = node->nextFree;
+  } else {
+    mBins[fl][sl] = node->nextFree;
+  }
+  if (nullptr != node->nextFree) {
+    node->nextFree->prevFree = node->prevFree;
+  }
+  if (nullptr == mBins[fl][sl]) {
+    mSlBitmap[fl] &= ~(1U << sl);
+    if (0 == mSlBitmap[fl]) {
+      mFlBitmap &= ~(1ULL << fl);
+    }
+  }
+  node->owner = nullptr;
+  node->prevFree = nullptr;
+  node->nextFree = nullptr;
+}
+
+EagerBufferAllocator::Node *
+EagerBufferAllocator::FreeIndex::findFit(size_t size) {
+  // round size up to the next bin boundary so any node of the found bin fits
+  size_t rounded = size;
+  if (size >= (size_t)SL_COUNT) {
+    int log2 = 63 - _clz64((uint64_t)size);
+    size_t step = ((size_t)1 << (log2 - SL_BITS)) - 1;
+    rounded = size + step < size ? size : size + step;
+  }
+  int fl, sl;
+  mapping(rounded, &fl, &sl);
+  uint32_t slMap = mSlBitmap[fl] & (~0U << sl);
+  if (0 == slMap) {
+    uint64_t flMap = fl + 1 < FL_COUNT ? mFlBitmap & (~0ULL << (fl + 1)) : 0;
+    if (0 != flMap) {
+      fl = _ctz64(flMap);
+      slMap = mSlBitmap[fl];
+    }
+  }
+  if (0 != slMap) {
+    return mBins[fl][_ctz64(slMap)];
+  }
+  // the bin of size itself may still hold a node that fits
+  mapping(size, &fl, &sl);
+  for (auto node = mBins[fl][sl]; nullptr != node; node = node->nextFree) {
+    if (node->size >= size) {
+      return node;
+    }
+  }
+  return nullptr;
+}
+
+EagerBufferAllocator::Node *EagerBufferAllocator::FreeIndex::first() {
+  if (0 == mFlBitmap) {
+    return nullptr;
+  }
+  int fl = _ctz64(mFlBitmap);
+  return mBins[fl][_ctz64(mSlBitmap[fl])];
+}
+
+size_t EagerBufferAllocator::UsedTable::slot(void *base, size_t offset) const {
+  uint64_t h = (uint64_t)(uintptr_t)base ^ ((uint64_t)offset * 0x9E3779B97F4A7C15ULL);
+  h ^= h >> 31;
+  h *= 0xBF58476D1CE4E5B9ULL;
+  h ^= h >> 29;
+  return (size_t)h & (mSlots.size() - 1);
+}
+
+void EagerBufferAllocator::UsedTable::grow() {
+  std::vector<Node *> old;
+  old.swap(mSlots);
+  mSlots.assign(old.empty() ? 64 : old.size() * 2, nullptr);
+  for (auto node : old) {
+    if (nullptr == node) {
+      continue;
+    }
+    auto index = slot(node->pointer.first, node->userOffset);
+    while (nullptr != mSlots[index]) {
+      index = (index + 1) & (mSlots.size() - 1);
+    }
+    mSlots[index] = node;
+  }
+}
+
+void EagerBufferAllocator::UsedTable::insert(Node *node) {
+  // keep the load factor under 1/2 so probe sequences stay short
+  if ((mCount + 1) * 2 > mSlots.size()) {
+    grow();
+  }
+  auto index = slot(node->pointer.first, node->userOffset);
+  while (nullptr != mSlots[index]) {
+    MNN_ASSERT(mSlots[index]->pointer.first != node->pointer.first ||
+               mSlots[index]->userOffset != node->userOffset);
+    index = (index + 1) & (mSlots.size() - 1);
+  }
+  mSlots[index] = node;
+  mCount++;
+}
+
+EagerBufferAllocator::Node *
+EagerBufferAllocator::UsedTable::take(const std::pair<void *, size_t> &pointer) {
+  if (0 == mCount) {
+    return nullptr;
+  }
+  auto mask = mSlots.size() - 1;
+  auto index = slot(pointer.first, pointer.second);
+  Node *node = nullptr;
+  for (;; index = (index + 1) & mask) {
+    node = mSlots[index];
+    if (nullptr == node) {
+      return nullptr;
+    }
+    if (node->pointer.first == pointer.first &&
+        node->userOffset == pointer.second) {
+      break;
+    }
+  }
+  // backward-shift deletion: pull later entries of the probe run into the hole
+  auto hole = index;
+  for (auto next = (hole + 1) & mask; nullptr != mSlots[next];
+       next = (next + 1) & mask) {
+    auto home = slot(mSlots[next]->pointer.first, mSlots[next]->userOffset);
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      mSlots[hole] = mSlots[next];
+      hole = next;
+    }
+  }
+  mSlots[hole] = nullptr;
+  mCount--;
+  return node;
+}
+
+void EagerBufferAllocator::UsedTable::clear() {
+  mSlots.clear();
+  mCount = 0;
+}
+
+void EagerBufferAllocator::UsedTable::moveTo(UsedTable *dst) {
+  for (auto node : mSlots) {
+    if (nullptr != node) {
+      dst->insert(node);
+    }
+  }
+  clear();
+}
 
-  if (nullptr == parent.get()) {
-    outside->onRelease(pointer);
+EagerBufferAllocator::Node *EagerBufferAllocator::newNode() {
+  if (nullptr == mSpareNodes) {
+    static const int SLAB_NODES = 64;
+    std::unique_ptr<Node[]> slab(new Node[SLAB_NODES]);
+    for (int i = 0; i < SLAB_NODES; ++i) {
+      slab[i].nextFree = mSpareNodes;
+      mSpareNodes = slab.get() + i;
+    }
+    mNodeSlabs.emplace_back(std::move(slab));
   }
+  auto node = mSpareNodes;
+  mSpareNodes = node->nextFree;
+  *node = Node();
+  return node;
+}
+
+void EagerBufferAllocator::deleteNode(Node *node) {
+  node->owner = nullptr;
+  node->nextFree = mSpareNodes;
+  mSpareNodes = node;
 }
+
+EagerBufferAllocator::Node *EagerBufferAllocator::splitTail(Node *node,
+                                                            size_t size) {
+  MNN_ASSERT(node->size > size);
+  auto tail = newNode();
+  tail->pointer.first = node->pointer.first;
+  tail->pointer.second = node->pointer.second + size;
+  tail->size = node->size - size;
+  tail->prevPhys = node;
+  tail->nextPhys = node->nextPhys;
+  if (nullptr != tail->nextPhys) {
+    tail->nextPhys->prevPhys = tail;
+  }
+  node->nextPhys = tail;
+  node->size = size;
+  return tail;
+}
+
+// < allocator, group > for every group begun on the calling thread
+static thread_local std::vector<std::pair<const void *, void *>> gThreadGroups;
+
+EagerBufferAllocator::Group *EagerBufferAllocator::threadGroup() const {
+  for (auto &iter : gThreadGroups) {
+    if (iter.first == this) {
+      return static_cast<Group *>(iter.second);
+    }
+  }
+  return nullptr;
+}
+
 MemChunk EagerBufferAllocator::alloc(size_t size, bool separate, size_t align) {
 #ifdef DUMP_USAGE
   auto memoryUsed = size / 1024.0f / 1024.0f;
@@ -199,18 +673,33 @@ MemChunk EagerBufferAllocator::alloc(size_t size, bool separate, size_t align) {
   if (0 == align) {
     align = mAlign;
   }
+  if (0 == size) {
+    // every chunk needs its own address to be looked up on free
+    size = mAlign;
+  }
+  auto group = threadGroup();
+  auto used = nullptr != group ? &group->usedList : &mUsedList;
   std::pair<void *, size_t> pointer;
-  // reuse if possible
-  if (!separate) {
-    if (nullptr != mCurrentFreeList) {
-      MNN_PRINT("alloc from mCurrentFreeList: %p\n", mCurrentFreeList);
-      pointer = getFromFreeList(mCurrentFreeList, size, false, align);
-    }
+  // the group's own list needs no lock
+  if (!separate && nullptr != group) {
+#ifdef DUMP_USAGE
+    MNN_PRINT("alloc from group: %p\n", group);
+#endif
+    pointer = getFromFreeList(&group->freeList, used, size, false, align);
     if (nullptr != pointer.first) {
       return MemChunk(pointer);
     }
+  }
+  std::unique_lock<std::mutex> lock(mMutex, std::defer_lock);
+  if (mInBarrier) {
+    lock.lock();
+  }
+  // reuse if possible
+  if (!separate) {
+#ifdef DUMP_USAGE
     MNN_PRINT("alloc from mFreeList: %p\n", &mFreeList);
-    pointer = getFromFreeList(&mFreeList, size, true, align);
+#endif
+    pointer = getFromFreeList(&mFreeList, used, size, true, align);
     if (nullptr != pointer.first) {
       return MemChunk(pointer);
     }
@@ -230,145 +719,177 @@ MemChunk EagerBufferAllocator::alloc(size_t size, bool separate, size_t align) {
   mTotalSize += allocSize;
 
   // save node
-  SharedPtr<Node> node(new Node);
+  auto node = newNode();
   node->size = allocSize;
   node->pointer = pointer;
-  node->outside = mAllocator.get();
+  node->userOffset = pointer.second;
+  mBlocks.emplace_back(node, allocSize);
   MNN_ASSERT(pointer.second % align == 0);
+  size = UP_DIV(size, mAlign) * mAlign;
   if (allocSize > size) {
-    size = UP_DIV(size, mAlign) * mAlign;
-    MNN_ASSERT(allocSize > size);
-
     // Split
-    SharedPtr<Node> first(new Node);
-    first->parent = node;
-    first->size = size;
-    first->pointer = pointer;
-    mUsedList.insert(std::make_pair(pointer, first));
-    node->useCount = 1;
-
-    SharedPtr<Node> second(new Node);
-    second->parent = node;
-    second->size = allocSize - size;
-    second->pointer.first = pointer.first;
-    second->pointer.second = pointer.second + size;
-    if (nullptr != mCurrentFreeList) {
-      mCurrentFreeList->insert(std::make_pair(second->size, second));
+    auto second = splitTail(node, size);
+    if (nullptr != group) {
+      group->freeList.insert(second);
     } else {
-      mFreeList.insert(std::make_pair(second->size, second));
+      mFreeList.insert(second);
     }
-  } else {
-    mUsedList[pointer] = node;
   }
+  used->insert(node);
 #ifdef DUMP_USAGE
   MNN_PRINT("mTotalSize: %f\n", mTotalSize / 1024.0f / 1024.0f);
 #endif
   return pointer;
 }
 
-void EagerBufferAllocator::returnMemory(FREELIST *listP, SharedPtr<Node> node,
+void EagerBufferAllocator::returnMemory(FREELIST *list, Node *node,
                                         bool permitMerge) {
-  auto &list = *listP;
-  list.insert(std::make_pair(node->size, node));
-  // update parent use count
-  if (nullptr != node->parent.get() && permitMerge) {
-    auto parent = node->parent;
-    parent->useCount -= 1;
-
-    // merge if all subnodes were freed
-    auto needMerge = parent->useCount == 0;
-    while (needMerge) {
-      // collect all subnodes
-      for (auto iter = list.begin(); iter != list.end();) {
-        if (iter->second->parent.get() == parent.get()) {
-          iter = list.erase(iter);
-          continue;
-        }
-        iter++;
+  if (permitMerge) {
+    // coalesce with free neighbours of the same list, the lower node survives
+    auto next = node->nextPhys;
+    if (nullptr != next && next->owner == list) {
+      list->remove(next);
+      node->size += next->size;
+      node->nextPhys = next->nextPhys;
+      if (nullptr != node->nextPhys) {
+        node->nextPhys->prevPhys = node;
       }
-
-      // do merge downside up
-      list.insert(std::make_pair(parent->size, parent));
-      needMerge = false;
-      if (parent->parent.get() != nullptr) {
-        parent = parent->parent;
-        parent->useCount -= 1;
-        needMerge = parent->useCount == 0;
+      deleteNode(next);
+    }
+    auto prev = node->prevPhys;
+    if (nullptr != prev && prev->owner == list) {
+      list->remove(prev);
+      prev->size += node->size;
+      prev->nextPhys = node->nextPhys;
+      if (nullptr != prev->nextPhys) {
+        prev->nextPhys->prevPhys = prev;
       }
+      deleteNode(node);
+      node = prev;
     }
   }
+  list->insert(node);
 }
 
 bool EagerBufferAllocator::free(MemChunk chunk) {
   std::pair<void *, size_t> pointer(chunk.first, chunk.second);
-  // get node
-  auto x = mUsedList.find(pointer);
-  if (x == mUsedList.end()) {
+  auto group = threadGroup();
+  // get node, chunks of the own group are found without a lock
+  Node *node = nullptr;
+  if (nullptr != group) {
+    node = group->usedList.take(pointer);
+  }
+  std::unique_lock<std::mutex> lock(mMutex, std::defer_lock);
+  if (nullptr == node) {
+    if (mInBarrier) {
+      lock.lock();
+    }
+    node = mUsedList.take(pointer);
+  }
+  if (nullptr == node) {
     MNN_ASSERT(false);
     return false;
   }
+#ifdef DUMP_USAGE
+  auto memoryUsed = node->size / 1024.0f / 1024.0f;
+  MNN_PRINT("Free: %f\n", memoryUsed);
+#endif
   // mark as reusable
-  auto node = x->second;
-  mUsedList.erase(x);
-  if (nullptr != mCurrentFreeList) {
-    returnMemory(mCurrentFreeList, node, false);
+  if (nullptr != group) {
+    returnMemory(&group->freeList, node, false);
   } else {
+    if (mInBarrier && !lock.owns_lock()) {
+      lock.lock();
+    }
     returnMemory(&mFreeList, node);
   }
-#ifdef DUMP_USAGE
-  if (node.get()) {
-    auto memoryUsed = node->size / 1024.0f / 1024.0f;
-    MNN_PRINT("Free: %f\n", memoryUsed);
-  }
-#endif
   return true;
 }
 
 void EagerBufferAllocator::release(bool allRelease) {
-  MNN_ASSERT(mGroups.empty());
+  MNN_ASSERT(nullptr == mFinishedGroups.load());
   if (allRelease) {
+    for (auto &block : mBlocks) {
+      mAllocator->onRelease(block.first->pointer);
+    }
+    mBlocks.clear();
     mUsedList.clear();
-    mFreeList.clear();
+    mFreeList = FREELIST();
+    mNodeSlabs.clear();
+    mSpareNodes = nullptr;
     mTotalSize = 0;
     return;
   }
-  for (auto iter = mFreeList.begin(); iter != mFreeList.end();) {
-    if (iter->second->parent.get() == nullptr) {
-      MNN_ASSERT(mTotalSize >= iter->first);
-      mTotalSize -= iter->first;
-      iter = mFreeList.erase(iter);
-    } else {
-      iter++;
+  // release the blocks that have been coalesced back into one free node
+  size_t kept = 0;
+  for (size_t i = 0; i < mBlocks.size(); ++i) {
+    auto node = mBlocks[i].first;
+    if (node->owner == &mFreeList && nullptr == node->nextPhys) {
+      MNN_ASSERT(mTotalSize >= mBlocks[i].second);
+      mTotalSize -= mBlocks[i].second;
+      mFreeList.remove(node);
+      mAllocator->onRelease(node->pointer);
+      deleteNode(node);
+      continue;
     }
+    mBlocks[kept++] = mBlocks[i];
   }
+  mBlocks.resize(kept);
 }
 
-void EagerBufferAllocator::barrierBegin() { MNN_ASSERT(mGroups.empty()); }
+void EagerBufferAllocator::barrierBegin() {
+  MNN_ASSERT(nullptr == mFinishedGroups.load());
+  mInBarrier = true;
+}
 
 void EagerBufferAllocator::barrierEnd() {
-  for (auto &freeGroup : mGroups) {
-    auto freeList = *freeGroup;
-    for (auto &iter : freeList) {
-      returnMemory(&mFreeList, iter.second);
+  // every group has ended: take them all at once and merge on this thread
+  auto group = mFinishedGroups.exchange(nullptr, std::memory_order_acquire);
+  while (nullptr != group) {
+    group->usedList.moveTo(&mUsedList);
+    for (auto node = group->freeList.first(); nullptr != node;
+         node = group->freeList.first()) {
+      group->freeList.remove(node);
+      returnMemory(&mFreeList, node);
     }
+    auto next = group->next;
+    delete group;
+    group = next;
   }
-  mGroups.clear();
+  mInBarrier = false;
 }
 
 void EagerBufferAllocator::beginGroup() {
-  std::shared_ptr<FREELIST> newFreeList(new FREELIST);
-  mCurrentFreeList = newFreeList.get();
-  MNN_PRINT("mCurrentFreeList: %p\n", mCurrentFreeList);
-  mGroups.emplace_back(newFreeList);
+  MNN_ASSERT(nullptr == threadGroup());
+  auto group = new Group;
+#ifdef DUMP_USAGE
+  MNN_PRINT("begin group: %p\n", group);
+#endif
+  gThreadGroups.emplace_back(this, group);
 }
 
-void EagerBufferAllocator::endGroup() { mCurrentFreeList = nullptr; }
+void EagerBufferAllocator::endGroup() {
+  for (auto iter = gThreadGroups.begin(); iter != gThreadGroups.end(); ++iter) {
+    if (iter->first != this) {
+      continue;
+    }
+    auto group = static_cast<Group *>(iter->second);
+    gThreadGroups.erase(iter);
+    auto head = mFinishedGroups.load(std::memory_order_relaxed);
+    do {
+      group->next = head;
+    } while (!mFinishedGroups.compare_exchange_weak(
+        head, group, std::memory_order_release, std::memory_order_relaxed));
+    return;
+  }
+}
 
 void EagerBufferAllocator::sync() { mAllocator->sync(); }
 
 std::pair<void *, size_t>
-EagerBufferAllocator::getFromFreeList(FREELIST *list, size_t size,
-                                      bool permiteSplit, size_t align) {
+EagerBufferAllocator::getFromFreeList(FREELIST *list, UsedTable *used,
+                                      size_t size, bool permiteSplit,
+                                      size_t align) {
 #ifdef MNN_DEBUG_MEMORY
   return std::make_pair(nullptr, 0);
 #endif
@@ -378,46 +899,26 @@ EagerBufferAllocator::getFromFreeList(FREELIST *list, size_t size,
     realSize = size + align - 1;
   }
   // get node larger than size
-  auto x = list->lower_bound(realSize);
-  if (x == list->end()) {
+  auto node = list->findFit(realSize);
+  if (nullptr == node) {
     return std::make_pair(nullptr, 0);
   }
-  // update parent use count
-  auto pointer = x->second->pointer;
+  auto pointer = node->pointer;
   // Align offset
   if (needExtraSize) {
     size_t originOffset = pointer.second;
     pointer.second = UP_DIV(originOffset, align) * align;
     realSize = size + pointer.second - originOffset;
   }
-  if (permiteSplit && nullptr != x->second->parent.get()) {
-    x->second->parent->useCount += 1;
-  }
+  list->remove(node);
+  node->userOffset = pointer.second;
 
-  // uses up all aligned space
+  // uses up all aligned space, split otherwise
   auto sizeAlign = UP_DIV(realSize, mAlign) * mAlign;
-  if (sizeAlign >= x->first || (!permiteSplit)) {
-    mUsedList.insert(std::make_pair(pointer, x->second));
-    list->erase(x);
-    MNN_ASSERT(pointer.second % align == 0);
-    return pointer;
-  }
-
-  // split otherwise
-  SharedPtr<Node> first(new Node);
-  first->parent = x->second;
-  first->size = sizeAlign;
-  first->pointer = x->second->pointer;
-  mUsedList.insert(std::make_pair(pointer, first));
-  x->second->useCount += 1;
-
-  SharedPtr<Node> second(new Node);
-  second->parent = x->second;
-  second->size = x->second->size - sizeAlign;
-  second->pointer.first = x->second->pointer.first;
-  second->pointer.second = x->second->pointer.second + sizeAlign;
-  list->erase(x);
-  list->insert(std::make_pair(second->size, second));
+  if (sizeAlign < node->size && permiteSplit) {
+    list->insert(splitTail(node, sizeAlign));
+  }
+  used->insert(node);
   MNN_ASSERT(pointer.second % align == 0);
   return pointer;
 }
@@ -450,8 +951,9 @@ ErrorCode SingleBufferWithAllocator::realloc(size_t size, size_t align) {
 
 DeferBufferAllocator::DeferBufferAllocator(SingleBufferWithAllocator *root,
                                            size_t align,
-                                           MemChunkApplyToTensor func)
-    : mAlign(align) {
+                                           MemChunkApplyToTensor func,
+                                           PlanMode mode)
+    : mAlign(align), mMode(mode), mTraceHash(0xCBF29CE484222325ULL) {
   if (nullptr == func) {
     mApplyFunction = _CPUMemChunkApplyToTensor;
   } else {
@@ -460,6 +962,12 @@ DeferBufferAllocator::DeferBufferAllocator(SingleBufferWithAllocator *root,
   mParent = root;
 }
 
+DeferBufferAllocator::~DeferBufferAllocator() {
+  if (nullptr != mPlan) {
+    MNNUnmapFile(mPlan, mPlanBytes);
+  }
+}
+
 //------------------------------- DeferBufferAllocator
 //-----------------------------------//
 MemChunk DeferBufferAllocator::alloc(size_t size, bool separate, size_t align) {
@@ -467,9 +975,22 @@ MemChunk DeferBufferAllocator::alloc(size_t size, bool separate, size_t align) {
     align = mAlign;
   }
   size = UP_DIV(size, align) * align;
+  hashTrace(1);
+  hashTrace(size);
+  hashTrace(align);
+  hashTrace(separate);
+  if (recordOnly()) {
+    // only record the lifetime, offsets are assigned in compute
+    auto newChunk = createMemNode(size);
+    newChunk->trace = mTrace.size();
+    mTrace.emplace_back(Lifetime{newChunk, align, mStep++, SIZE_MAX});
+    return MemChunk(newChunk);
+  }
   if (mFreeList.empty() || separate) {
     auto newChunk = createMemNode(size);
     insert_after(newChunk);
+    newChunk->trace = mTrace.size();
+    mTrace.emplace_back(Lifetime{newChunk, align, mStep++, SIZE_MAX});
 #ifdef DUMP_USAGE
     MNN_PRINT("Defer alloc: %p, %d\n", newChunk, size);
 #endif
@@ -493,6 +1014,8 @@ MemChunk DeferBufferAllocator::alloc(size_t size, bool separate, size_t align) {
   }
   // equal no change; small expand
   selectChunk->size = size;
+  selectChunk->trace = mTrace.size();
+  mTrace.emplace_back(Lifetime{selectChunk, align, mStep++, SIZE_MAX});
 #ifdef DUMP_USAGE
   MNN_PRINT("Defer alloc: %p, %d\n", selectChunk, size);
 #endif
@@ -510,6 +1033,16 @@ bool DeferBufferAllocator::free(MemChunk chunk) {
   if (!node) {
     return false;
   }
+  if (node->trace >= mTrace.size() || mTrace[node->trace].node != node) {
+    return false;
+  }
+  hashTrace(2);
+  hashTrace(node->trace);
+  mTrace[node->trace].end = mStep++;
+  if (recordOnly()) {
+    node->usage = false;
+    return true;
+  }
   auto left = node->left;
   auto right = node->right;
   if (left && !left->usage) {
@@ -562,12 +1095,21 @@ void DeferBufferAllocator::reset() {
   mTail = nullptr;
   mBarrrier = false;
   mBarrrierFreeChunks.clear();
+  mTrace.clear();
+  mStep = 0;
+  mTraceHash = 0xCBF29CE484222325ULL;
 }
 
 ErrorCode DeferBufferAllocator::compute() {
   if (mTotalSize > 0) {
     return NO_ERROR;
   }
+  if (nullptr != mPlan && applyPlan()) {
+    return apply();
+  }
+  if (recordOnly()) {
+    return computeByLifetime();
+  }
   mTotalSize = 0;
   if (mFreeList.empty()) {
     return NO_ERROR;
@@ -588,7 +1130,8 @@ ErrorCode DeferBufferAllocator::compute() {
   return apply();
 }
 ErrorCode DeferBufferAllocator::apply() {
-  if (mFreeList.empty()) {
+  bool empty = recordOnly() ? mChunks.empty() : mFreeList.empty();
+  if (empty) {
     // Not alloc
     return NO_ERROR;
   }
@@ -616,6 +1159,172 @@ ErrorCode DeferBufferAllocator::apply() {
   return NO_ERROR;
 }
 
+size_t DeferBufferAllocator::planInOrder(const std::vector<size_t> &order,
+                                         std::vector<size_t> &offsets) const {
+  offsets.assign(mTrace.size(), 0);
+  // chunks placed so far, ordered by offset
+  std::vector<size_t> placed;
+  placed.reserve(mTrace.size());
+  size_t total = 0;
+  for (auto index : order) {
+    auto &item = mTrace[index];
+    auto size = item.node->size;
+    // take the smallest gap between chunks alive at the same time that fits
+    size_t best = SIZE_MAX, bestGap = SIZE_MAX, cursor = 0;
+    for (auto other : placed) {
+      auto &live = mTrace[other];
+      if (live.begin >= item.end || item.begin >= live.end) {
+        continue;
+      }
+      auto start = UP_DIV(cursor, item.align) * item.align;
+      if (offsets[other] >= start + size &&
+          offsets[other] - start < bestGap) {
+        best = start;
+        bestGap = offsets[other] - start;
+      }
+      cursor = ALIMAX(cursor, offsets[other] + live.node->size);
+    }
+    if (SIZE_MAX == best) {
+      best = UP_DIV(cursor, item.align) * item.align;
+    }
+    offsets[index] = best;
+    total = ALIMAX(total, best + size);
+    auto pos = std::upper_bound(
+        placed.begin(), placed.end(), best,
+        [&offsets](size_t offset, size_t other) { return offset < offsets[other]; });
+    placed.insert(pos, index);
+  }
+  return total;
+}
+
+ErrorCode DeferBufferAllocator::computeByLifetime() {
+  mTotalSize = 0;
+  if (mTrace.empty()) {
+    return NO_ERROR;
+  }
+  // greedy by size: large chunks first, they are the hardest to fit later
+  std::vector<size_t> bySize(mTrace.size());
+  std::iota(bySize.begin(), bySize.end(), 0);
+  std::stable_sort(bySize.begin(), bySize.end(), [this](size_t a, size_t b) {
+    return mTrace[a].node->size > mTrace[b].node->size;
+  });
+  std::vector<size_t> sizeOffsets;
+  auto sizeTotal = planInOrder(bySize, sizeOffsets);
+
+  // first fit in allocation order, kept when it happens to be tighter
+  std::vector<size_t> byBegin(mTrace.size());
+  std::iota(byBegin.begin(), byBegin.end(), 0);
+  std::vector<size_t> beginOffsets;
+  auto beginTotal = planInOrder(byBegin, beginOffsets);
+
+  auto &offsets = sizeTotal <= beginTotal ? sizeOffsets : beginOffsets;
+  mTotalSize = ALIMIN(sizeTotal, beginTotal);
+  for (size_t i = 0; i < mTrace.size(); ++i) {
+    mTrace[i].node->offset = offsets[i];
+  }
+  return apply();
+}
+
+// persisted plan: header, then one offset per alloc in trace order
+struct DeferPlanHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t hash;
+  uint64_t count;
+  uint64_t totalSize;
+};
+static const uint32_t gDeferPlanMagic = 0x4E4C504D; // "MPLN"
+static const uint32_t gDeferPlanVersion = 1;
+
+void DeferBufferAllocator::hashTrace(uint64_t value) {
+  // FNV-1a over 64-bit words
+  mTraceHash ^= value;
+  mTraceHash *= 0x100000001B3ULL;
+}
+
+bool DeferBufferAllocator::applyPlan() {
+  auto header = static_cast<const DeferPlanHeader *>(mPlan);
+  if (header->hash != mTraceHash || header->count != mTrace.size()) {
+    return false;
+  }
+  auto offsets = reinterpret_cast<const uint64_t *>(header + 1);
+  for (size_t i = 0; i < mTrace.size(); ++i) {
+    mTrace[i].node->offset = (size_t)offsets[i];
+  }
+  mTotalSize = (size_t)header->totalSize;
+  return true;
+}
+
+ErrorCode DeferBufferAllocator::savePlan(const char *path) const {
+  if (!mTrace.empty() && 0 == mTotalSize) {
+    // not computed yet
+    return INVALID_VALUE;
+  }
+  std::vector<uint64_t> offsets(mTrace.size());
+  for (size_t i = 0; i < mTrace.size(); ++i) {
+    offsets[i] = mTrace[i].node->offset;
+  }
+  DeferPlanHeader header;
+  header.magic = gDeferPlanMagic;
+  header.version = gDeferPlanVersion;
+  header.hash = mTraceHash;
+  header.count = mTrace.size();
+  header.totalSize = mTotalSize;
+  file_t file = MNNCreateFile(path);
+  if (INVALID_FILE == file) {
+    return FILE_CREATE_FAILED;
+  }
+  size_t bytes = offsets.size() * sizeof(uint64_t);
+  bool success = MNNWriteFile(file, &header, sizeof(header)) == sizeof(header);
+  if (success && bytes > 0) {
+    success = MNNWriteFile(file, offsets.data(), bytes) == bytes;
+  }
+  MNNCloseFile(file);
+  if (!success) {
+    MNNRemoveFile(path);
+    return FILE_CREATE_FAILED;
+  }
+  return NO_ERROR;
+}
+
+ErrorCode DeferBufferAllocator::loadPlan(const char *path) {
+  if (!mTrace.empty()) {
+    // the trace must be recorded from the first alloc on
+    return INVALID_VALUE;
+  }
+  if (!MNNFileExist(path)) {
+    return FILE_NOT_EXIST;
+  }
+  file_t file = MNNOpenFile(path, MNN_FILE_READ);
+  if (INVALID_FILE == file) {
+    return FILE_OPEN_FAILED;
+  }
+  size_t bytes = MNNGetFileSize(file);
+  void *addr = nullptr;
+  if (INVALID_SIZE != bytes && bytes >= sizeof(DeferPlanHeader)) {
+    addr = MNNMmapFileReadOnly(file, bytes);
+  }
+  // the mapping stays valid after the file is closed
+  MNNCloseFile(file);
+  if (nullptr == addr) {
+    return INVALID_VALUE;
+  }
+  auto header = static_cast<const DeferPlanHeader *>(addr);
+  if (header->magic != gDeferPlanMagic ||
+      header->version != gDeferPlanVersion ||
+      (bytes - sizeof(DeferPlanHeader)) / sizeof(uint64_t) != header->count ||
+      (bytes - sizeof(DeferPlanHeader)) % sizeof(uint64_t) != 0) {
+    MNNUnmapFile(addr, bytes);
+    return INVALID_VALUE;
+  }
+  if (nullptr != mPlan) {
+    MNNUnmapFile(mPlan, mPlanBytes);
+  }
+  mPlan = addr;
+  mPlanBytes = bytes;
+  return NO_ERROR;
+}
+
 // some utils functions of DeferBufferAllocator
 void DeferBufferAllocator::visiChildren(MemNode *chunk) {
   if (!chunk)
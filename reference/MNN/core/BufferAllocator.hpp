@@ -9,8 +9,11 @@
 #ifndef BufferAllocator_hpp
 #define BufferAllocator_hpp
 
+#include <atomic>
+#include <cstdint>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <vector>
 #include <MNN/ErrorCode.hpp>
@@ -34,6 +37,8 @@ public:
   size_t size = 0, offset = 0;
   void *base = nullptr;
   bool usage = true;
+  // index into the lifetime trace, DeferBufferAllocator::PLAN_LIFETIME only
+  size_t trace = 0;
   MemNode *left = nullptr, *right = nullptr;
   std::vector<MemNode *> children;
   std::vector<Tensor *> tensors;
@@ -93,6 +98,14 @@ public:
                                                  const char *prefix,
                                                  const char *posfix,
                                                  bool autoRemove = true);
+    // one growable backing file (an anonymous memfd when dirName is nullptr
+    // on Linux) mapped into a reserved range of reserveSize bytes (0 for a
+    // default), chunks are sub-allocated inside it
+    static std::shared_ptr<Allocator> createMmapPool(const char *dirName,
+                                                     const char *prefix,
+                                                     const char *posfix,
+                                                     bool autoRemove = true,
+                                                     size_t reserveSize = 0);
     static std::shared_ptr<Allocator> createRecurse(BufferAllocator *parent);
   };
   BufferAllocator() = default;
@@ -167,6 +180,14 @@ public:
    begin group / end group means the memory allocated belong to one thread
    different group must use different memory,
    but the origin freelist can be used by every group
+
+   alloc / free may be called concurrently between barrierBegin and
+   barrierEnd without external locking: a group's free list and used chunks
+   belong to the thread that began it and are touched without a lock, only
+   the shared freelist and the outside allocator are locked. endGroup hands
+   the group over on a lock-free stack and barrierEnd merges it back.
+   A chunk allocated in a group must be freed by the same group or after
+   barrierEnd.
    */
   void barrierBegin() override;
   void barrierEnd() override;
@@ -175,28 +196,98 @@ public:
   void sync() override;
 
 private:
-  class Node : public RefCount {
+  class FreeIndex;
+  // A contiguous range of a block obtained from the outside allocator. Nodes
+  // of one block are linked in address order so freed neighbours coalesce in
+  // O(1); free nodes are also linked into one bin of a FreeIndex.
+  struct Node {
+    std::pair<void *, size_t> pointer; // < base, offset > of the range start
+    size_t size = 0;
+    size_t userOffset = 0;     // offset handed out (aligned), used nodes only
+    Node *prevPhys = nullptr;  // neighbours inside the same outside block
+    Node *nextPhys = nullptr;
+    Node *prevFree = nullptr;  // bin links while free
+    Node *nextFree = nullptr;
+    FreeIndex *owner = nullptr; // index holding the node, nullptr if used
+  };
+
+  // TLSF-style segregated fit: a size maps to a first level (log2) and a
+  // second level (the next SL_BITS bits); a bitmap per level finds the first
+  // non-empty bin that can hold a request with one ffs each.
+  class FreeIndex {
+  public:
+    static const int SL_BITS = 4;
+    static const int SL_COUNT = 1 << SL_BITS;
+    static const int FL_COUNT = 64 - SL_BITS + 1;
+
+    FreeIndex();
+    void insert(Node *node);
+    void remove(Node *node);
+    // smallest-bin node with size >= size, nullptr if none
+    Node *findFit(size_t size);
+    // any free node, nullptr if empty (used to drain an index)
+    Node *first();
+    bool empty() const { return mFlBitmap == 0; }
+
+  private:
+    static void mapping(size_t size, int *fl, int *sl);
+    uint64_t mFlBitmap = 0;
+    uint32_t mSlBitmap[FL_COUNT];
+    Node *mBins[FL_COUNT][SL_COUNT];
+  };
+
+  // Open-addressing hash from the handed-out < base, offset > to its node,
+  // replacing the ordered map of used chunks.
+  class UsedTable {
   public:
-    ~Node();
-    std::pair<void *, size_t> pointer;  // < base, offset >
-    SharedPtr<Node> parent = nullptr;
-    size_t size;
-    size_t useCount = 0;
-    Allocator *outside = nullptr;
+    void insert(Node *node);
+    // removes and returns the node handed out at pointer, nullptr if unknown
+    Node *take(const std::pair<void *, size_t> &pointer);
+    void clear();
+    // moves every entry into dst, leaving this table empty
+    void moveTo(UsedTable *dst);
+
+  private:
+    size_t slot(void *base, size_t offset) const;
+    void grow();
+    std::vector<Node *> mSlots;
+    size_t mCount = 0;
   };
 
-  typedef std::multimap<size_t, SharedPtr<Node>> FREELIST;
+  typedef FreeIndex FREELIST;
 
-  static void returnMemory(FREELIST *list, SharedPtr<Node> node,
-                           bool permitMerge = true);
-  std::pair<void *, size_t> getFromFreeList(FREELIST *list, size_t size,
-                                            bool permiteSplit, size_t align);
+  // state of one beginGroup / endGroup, owned by the thread that began it
+  struct Group {
+    FREELIST freeList;
+    UsedTable usedList;
+    Group *next = nullptr; // link in mFinishedGroups
+  };
+  // the group the calling thread has begun on this allocator, or nullptr
+  Group *threadGroup() const;
 
-  std::map<std::pair<void *, size_t>, SharedPtr<Node>> mUsedList;
+  void returnMemory(FREELIST *list, Node *node, bool permitMerge = true);
+  std::pair<void *, size_t> getFromFreeList(FREELIST *list, UsedTable *used,
+                                            size_t size, bool permiteSplit,
+                                            size_t align);
+  // split the tail beyond size off node into its own node, returns the tail
+  Node *splitTail(Node *node, size_t size);
+  Node *newNode();
+  void deleteNode(Node *node);
+
+  UsedTable mUsedList;
   FREELIST mFreeList;
+  // blocks obtained from mAllocator: < first node, size >, the first node of
+  // a block absorbs its freed neighbours and lives as long as the block
+  std::vector<std::pair<Node *, size_t>> mBlocks;
+  // nodes are recycled through a free list, slabs are kept until destruction
+  std::vector<std::unique_ptr<Node[]>> mNodeSlabs;
+  Node *mSpareNodes = nullptr;
 
-  FREELIST *mCurrentFreeList = nullptr;
-  std::vector<std::shared_ptr<FREELIST>> mGroups;
+  // groups ended but not merged yet, pushed by endGroup without a lock
+  std::atomic<Group *> mFinishedGroups{nullptr};
+  // guards the shared lists, node pool and mAllocator inside a barrier
+  std::mutex mMutex;
+  bool mInBarrier = false;
   std::shared_ptr<Allocator> mAllocator;
   size_t mAlign;
   size_t mMinAllocSize = 0;
@@ -215,12 +306,18 @@ public:
 };
 class MNN_PUBLIC DeferBufferAllocator : public BufferAllocator {
 public:
+  enum PlanMode {
+    // assign ranges online, reusing and fusing freed ranges as calls arrive
+    PLAN_ONLINE = 0,
+    // record the whole alloc / free trace, compute() assigns offsets by
+    // lifetime so that only chunks alive at the same time must not overlap
+    PLAN_LIFETIME = 1,
+  };
   DeferBufferAllocator(SingleBufferWithAllocator *parent,
                        size_t align = MNN_MEMORY_ALIGN_DEFAULT,
-                       MemChunkApplyToTensor func = nullptr);
-  virtual ~DeferBufferAllocator() {
-    // Donothing
-  }
+                       MemChunkApplyToTensor func = nullptr,
+                       PlanMode mode = PLAN_ONLINE);
+  virtual ~DeferBufferAllocator();
 
 public:
   MemChunk alloc(size_t size, bool separate = false, size_t align = 0) override;
@@ -234,6 +331,19 @@ public:
   ErrorCode compute() override;
   ErrorCode apply() override;
 
+  /**
+   * @brief write the offsets computed for the current trace to a file,
+   * keyed by a hash of the alloc / free calls since reset.
+   */
+  ErrorCode savePlan(const char *path) const;
+  /**
+   * @brief map a plan written by savePlan, call before the first alloc.
+   * alloc / free then only record the trace, and compute() applies the
+   * stored offsets when the trace hash matches or plans by lifetime
+   * otherwise.
+   */
+  ErrorCode loadPlan(const char *path);
+
 private:
   std::vector<std::unique_ptr<MemNode>> mChunks;
   MemNode *mHead = nullptr, *mTail = nullptr;
@@ -244,6 +354,20 @@ private:
   // barrier
   bool mBarrrier = false;
   std::vector<MemChunk> mBarrrierFreeChunks;
+  // lifetime trace: chunk alive in steps [begin, end)
+  struct Lifetime {
+    MemNode *node;
+    size_t align;
+    size_t begin;
+    size_t end;
+  };
+  PlanMode mMode;
+  std::vector<Lifetime> mTrace;
+  size_t mStep = 0;
+  uint64_t mTraceHash;
+  // plan mapped by loadPlan
+  void *mPlan = nullptr;
+  size_t mPlanBytes = 0;
 
 private:
   MemNode *createMemNode(size_t size);
@@ -253,6 +377,14 @@ private:
   void insertFree(MemNode *chunk);
   void eraseFree(MemNode *chunk);
   void visiChildren(MemNode *chunk);
+  // place the trace in the given order, returns the arena size
+  size_t planInOrder(const std::vector<size_t> &order,
+                     std::vector<size_t> &offsets) const;
+  ErrorCode computeByLifetime();
+  // trace only, offsets come from the lifetime planner or a loaded plan
+  bool recordOnly() const { return PLAN_LIFETIME == mMode || nullptr != mPlan; }
+  void hashTrace(uint64_t value);
+  bool applyPlan();
   MemChunkApplyToTensor mApplyFunction;
   SingleBufferWithAllocator *mParent;
 };
@@ -8,24 +8,28 @@
 
 using namespace MNN;
 
-std::mutex mem_mutex;
+// 仅用于串行化输出，分配与释放本身不需要外部加锁
+std::mutex print_mutex;
 
 // 线程任务：在group内进行内存分配和释放
 void threadTask(EagerBufferAllocator *allocator, int threadId,
                 std::vector<MemChunk> &threadChunks) {
   // 1. 开始线程组（线程隔离）
   allocator->beginGroup();
-  std::cout << "Thread " << threadId << " start group" << std::endl;
+  {
+    std::lock_guard<std::mutex> lock(print_mutex);
+    std::cout << "Thread " << threadId << " start group" << std::endl;
+  }
 
   // 2. 分配多个内存块并记录
   for (int i = 0; i < 5; ++i) {
+    size_t allocSize =
+        1024 * (i + 1); // 分配不同大小的内存（1KB, 2KB, ..., 5KB）
+    MemChunk chunk = allocator->alloc(allocSize);
+    assert(!chunk.invalid() && "Allocation failed");
+    threadChunks.push_back(chunk);
     {
-      std::lock_guard<std::mutex> lock(mem_mutex);
-      size_t allocSize =
-          1024 * (i + 1); // 分配不同大小的内存（1KB, 2KB, ..., 5KB）
-      MemChunk chunk = allocator->alloc(allocSize);
-      assert(!chunk.invalid() && "Allocation failed");
-      threadChunks.push_back(chunk);
+      std::lock_guard<std::mutex> lock(print_mutex);
       std::cout << "Thread " << threadId << " alloc: " << chunk.ptr()
                 << " (size: " << allocSize << ")" << std::endl;
     }
@@ -35,10 +39,12 @@ void threadTask(EagerBufferAllocator *allocator, int threadId,
   // 3. 释放部分内存块（模拟中间释放操作）
   for (int i = 0; i < 3; ++i) {
     if (!threadChunks[i].invalid()) {
-      std::lock_guard<std::mutex> lock(mem_mutex);
-      std::cout << "Thread " << threadId
-                << " free: " << static_cast<void *>(threadChunks[i].ptr())
-                << std::endl;
+      {
+        std::lock_guard<std::mutex> lock(print_mutex);
+        std::cout << "Thread " << threadId
+                  << " free: " << static_cast<void *>(threadChunks[i].ptr())
+                  << std::endl;
+      }
       allocator->free(threadChunks[i]);
       threadChunks[i] = MemChunk(); // 标记为无效
     }
@@ -47,7 +53,10 @@ void threadTask(EagerBufferAllocator *allocator, int threadId,
 
   // 4. 结束线程组（释放隔离状态）
   allocator->endGroup();
-  std::cout << "Thread " << threadId << " end group" << std::endl;
+  {
+    std::lock_guard<std::mutex> lock(print_mutex);
+    std::cout << "Thread " << threadId << " end group" << std::endl;
+  }
 }
 
 int eager_buffer_allocator_multithread_test() {